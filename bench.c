@@ -0,0 +1,675 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "lk_array.h"
+#include "lk_concurrent.h"
+#include "lk_algorithm.h"
+#include "lk_ring.h"
+#include "lk_soa.h"
+#include "lk_parallel.h"
+#include "lk_serial.h"
+#include "lk_fd.h"
+#include "lk_hash.h"
+
+/*
+ * Benchmarks for lk_array and friends.
+ *
+ * Prints one CSV line per measurement:
+ *      benchmark,memb_size,elements,threads,ns_per_op,bytes_copied
+ * Benchmarks prefixed with raw_ run on plain malloc'd buffers and are the
+ * baseline for the lk_array ones with the same name.
+ * bytes_copied counts element bytes written by memcpy, plus the bytes
+ * moved by reallocations (assuming every reallocation moves the block).
+ *
+ * Usage: lk_array_bench [max_bytes]
+ * Arrays of 16 KiB (L1 resident) up to max_bytes (default 64 MiB) are
+ * benchmarked, growing by 8x. Pass a max_bytes larger than RAM to
+ * measure swapping.
+ */
+
+static const size_t memb_sizes[] = { 1, 4, 16, 64, 256 };
+
+// keeps the compiler from optimizing reads away
+static volatile unsigned char sink;
+
+static uint64_t xorshift(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void print_header(void) {
+    printf("benchmark,memb_size,elements,threads,ns_per_op,bytes_copied\n");
+}
+
+static void print_result(const char* name, size_t memb_size, size_t elements, size_t threads,
+    double ns, size_t ops, size_t bytes_copied) {
+    printf("%s,%zu,%zu,%zu,%.3f,%zu\n", name, memb_size, elements, threads, ns / (double)ops, bytes_copied);
+    fflush(stdout);
+}
+
+// Sums up the bytes moved by reallocations, when the capacity of arr changed.
+static size_t realloc_bytes(lk_array* arr, size_t* last_capacity) {
+    size_t bytes = 0;
+    if (arr->capacity != *last_capacity) {
+        bytes          = *last_capacity * arr->memb_size;
+        *last_capacity = arr->capacity;
+    }
+    return bytes;
+}
+
+static void bench_push_back(size_t memb_size, size_t n, unsigned char* element) {
+    lk_array* arr           = lk_new_array(0, memb_size);
+    size_t    last_capacity = 0;
+    size_t    moved         = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        lk_push_back(arr, element);
+        moved += realloc_bytes(arr, &last_capacity);
+    }
+    double end = now_ns();
+
+    print_result("push_back", memb_size, n, 1, end - start, n, n * memb_size + moved);
+    lk_free_array(arr);
+}
+
+static void bench_reserve_fill(size_t memb_size, size_t n, unsigned char* element) {
+    lk_array* arr = lk_new_array(0, memb_size);
+
+    double start = now_ns();
+    lk_reserve(arr, n);
+    for (size_t i = 0; i < n; ++i) {
+        lk_push_back(arr, element);
+    }
+    double end = now_ns();
+
+    print_result("reserve_fill", memb_size, n, 1, end - start, n, n * memb_size);
+    lk_free_array(arr);
+}
+
+// Creates an array of n elements and overwrites all of them.
+static void bench_new_fill(size_t memb_size, size_t n, unsigned char* element, bool uninit) {
+    double    start = now_ns();
+    lk_array* arr   = uninit ? lk_new_array_uninit(n, memb_size) : lk_new_array(n, memb_size);
+    for (size_t i = 0; i < n; ++i) {
+        memcpy((char*)arr->data + i * memb_size, element, memb_size);
+    }
+    double end = now_ns();
+
+    print_result(uninit ? "new_uninit_fill" : "new_fill", memb_size, n, 1, end - start, n, n * memb_size);
+    lk_free_array(arr);
+}
+
+static void bench_raw_fill(size_t memb_size, size_t n, unsigned char* element) {
+    double         start = now_ns();
+    unsigned char* raw   = malloc(n * memb_size);
+    for (size_t i = 0; i < n; ++i) {
+        memcpy(raw + i * memb_size, element, memb_size);
+    }
+    double end = now_ns();
+
+    sink = raw[n * memb_size - 1];
+    print_result("raw_fill", memb_size, n, 1, end - start, n, n * memb_size);
+    free(raw);
+}
+
+static void bench_set(lk_array* arr, unsigned char* element) {
+    size_t n = arr->size;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        lk_set(arr, i, element);
+    }
+    double end = now_ns();
+
+    print_result("set", arr->memb_size, n, 1, end - start, n, n * arr->memb_size);
+}
+
+static void bench_sequential_scan(lk_array* arr) {
+    size_t        n   = arr->size;
+    unsigned char acc = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        acc ^= *lk_at(arr, unsigned char, i);
+    }
+    double end = now_ns();
+
+    sink = acc;
+    print_result("sequential_scan", arr->memb_size, n, 1, end - start, n, 0);
+}
+
+static void bench_raw_sequential_scan(unsigned char* raw, size_t memb_size, size_t n) {
+    unsigned char acc = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        acc ^= raw[i * memb_size];
+    }
+    double end = now_ns();
+
+    sink = acc;
+    print_result("raw_sequential_scan", memb_size, n, 1, end - start, n, 0);
+}
+
+// n has to be a power of two
+static void bench_random_at(lk_array* arr) {
+    size_t        n     = arr->size;
+    uint64_t      state = 0x9E3779B97F4A7C15ull;
+    unsigned char acc   = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        acc ^= *lk_at(arr, unsigned char, xorshift(&state) & (n - 1));
+    }
+    double end = now_ns();
+
+    sink = acc;
+    print_result("random_at", arr->memb_size, n, 1, end - start, n, 0);
+}
+
+// n has to be a power of two
+static void bench_raw_random_read(unsigned char* raw, size_t memb_size, size_t n) {
+    uint64_t      state = 0x9E3779B97F4A7C15ull;
+    unsigned char acc   = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        acc ^= raw[(xorshift(&state) & (n - 1)) * memb_size];
+    }
+    double end = now_ns();
+
+    sink = acc;
+    print_result("raw_random_read", memb_size, n, 1, end - start, n, 0);
+}
+
+static void bench_deep_copy(lk_array* arr) {
+    lk_array* copy = lk_new_array(0, arr->memb_size);
+
+    double start = now_ns();
+    lk_array_deep_copy(copy, arr);
+    double end = now_ns();
+
+    size_t bytes = arr->size * arr->memb_size;
+    print_result("deep_copy", arr->memb_size, arr->size, 1, end - start, arr->size, bytes);
+    lk_free_array(copy);
+}
+
+static void bench_raw_copy(unsigned char* raw, size_t memb_size, size_t n) {
+    double         start = now_ns();
+    unsigned char* copy  = malloc(n * memb_size);
+    memcpy(copy, raw, n * memb_size);
+    double end = now_ns();
+
+    sink = copy[n * memb_size - 1];
+    print_result("raw_copy", memb_size, n, 1, end - start, n, n * memb_size);
+    free(copy);
+}
+
+// Looks for a sentinel in the last element, so the whole array is scanned.
+static void bench_find(lk_array* arr, unsigned char* sentinel) {
+    size_t n     = arr->size;
+    size_t index = 0;
+    lk_set(arr, n - 1, sentinel);
+
+    double start = now_ns();
+    lk_find(arr, sentinel, &index);
+    double end = now_ns();
+
+    sink = (unsigned char)index;
+    print_result("find", arr->memb_size, n, 1, end - start, n, 0);
+}
+
+static void bench_raw_find(unsigned char* raw, size_t memb_size, size_t n, unsigned char* sentinel) {
+    size_t index = n;
+
+    double start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        if (memcmp(raw + i * memb_size, sentinel, memb_size) == 0) {
+            index = i;
+            break;
+        }
+    }
+    double end = now_ns();
+
+    sink = (unsigned char)index;
+    print_result("raw_find", memb_size, n, 1, end - start, n, 0);
+}
+
+static void bench_count(lk_array* arr, unsigned char* element) {
+    size_t n = arr->size;
+
+    double start = now_ns();
+    size_t count = lk_count(arr, element);
+    double end   = now_ns();
+
+    sink = (unsigned char)count;
+    print_result("count", arr->memb_size, n, 1, end - start, n, 0);
+}
+
+static void bench_resize_churn(size_t memb_size, size_t n) {
+    lk_array*    arr    = lk_new_array(0, memb_size);
+    const size_t rounds = 16;
+
+    double start = now_ns();
+    for (size_t i = 0; i < rounds; ++i) {
+        lk_resize(arr, n);
+        lk_resize(arr, n / 2);
+        lk_resize(arr, 0);
+    }
+    double end = now_ns();
+
+    print_result("resize_churn", memb_size, n, 1, end - start, rounds * 3, 0);
+    lk_free_array(arr);
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x;
+    uint64_t y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return (x > y) - (x < y);
+}
+
+// Sorts n elements by a random uint64_t key at the start of each element.
+// algorithm 0 is lk_sort, 1 lk_stable_sort and 2 lk_radix_sort.
+static void bench_sort(size_t memb_size, size_t n, int algorithm) {
+    static const char* names[] = { "sort", "stable_sort", "radix_sort" };
+    lk_array*          arr     = lk_new_array(n, memb_size);
+    uint64_t           state   = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = xorshift(&state);
+        memcpy((char*)arr->data + i * memb_size, &key, sizeof(key));
+    }
+
+    double start = now_ns();
+    if (algorithm == 0) {
+        lk_sort(arr, compare_u64);
+    } else if (algorithm == 1) {
+        lk_stable_sort(arr, compare_u64);
+    } else {
+        lk_radix_sort(arr, 0, sizeof(uint64_t), false);
+    }
+    double end = now_ns();
+
+    print_result(names[algorithm], memb_size, n, 1, end - start, n, 0);
+    lk_free_array(arr);
+}
+
+static void bench_array_sizes(size_t max_bytes) {
+    unsigned char element[256];
+    unsigned char sentinel[256];
+    memset(element, 0xab, sizeof(element));
+    memset(sentinel, 0xcd, sizeof(sentinel));
+
+    for (size_t bytes = (size_t)16 << 10; bytes <= max_bytes; bytes *= 8) {
+        for (size_t m = 0; m < sizeof(memb_sizes) / sizeof(memb_sizes[0]); ++m) {
+            size_t memb_size = memb_sizes[m];
+            size_t n         = bytes / memb_size;
+
+            bench_push_back(memb_size, n, element);
+            bench_reserve_fill(memb_size, n, element);
+            bench_raw_fill(memb_size, n, element);
+            bench_new_fill(memb_size, n, element, false);
+            bench_new_fill(memb_size, n, element, true);
+
+            lk_array* arr = lk_new_array(n, memb_size);
+            bench_set(arr, element);
+            bench_sequential_scan(arr);
+            bench_random_at(arr);
+            bench_deep_copy(arr);
+            bench_count(arr, element);
+            bench_find(arr, sentinel);
+            bench_raw_find(arr->data, memb_size, n, sentinel);
+            bench_raw_sequential_scan(arr->data, memb_size, n);
+            bench_raw_random_read(arr->data, memb_size, n);
+            bench_raw_copy(arr->data, memb_size, n);
+            lk_free_array(arr);
+
+            bench_resize_churn(memb_size, n);
+
+            if (memb_size >= sizeof(uint64_t)) {
+                for (int algorithm = 0; algorithm < 3; ++algorithm) {
+                    bench_sort(memb_size, n, algorithm);
+                }
+            }
+        }
+    }
+}
+
+#define RECORD_SIZE 200
+
+// Sums one 8 byte field of n records of RECORD_SIZE bytes, stored as an
+// array of records and as columns.
+static void bench_record_scan(size_t n) {
+    size_t    sizes[] = { sizeof(uint64_t), RECORD_SIZE - sizeof(uint64_t) };
+    lk_soa*   soa     = lk_new_soa(2, sizes, NULL, 0);
+    lk_array* aos     = lk_new_array(n, RECORD_SIZE);
+    lk_soa_resize(soa, n);
+
+    uint64_t sum   = 0;
+    double   start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t value;
+        memcpy(&value, (char*)aos->data + i * RECORD_SIZE, sizeof(value));
+        sum += value;
+    }
+    double end = now_ns();
+    print_result("aos_field_scan", RECORD_SIZE, n, 1, end - start, n, 0);
+
+    uint64_t* column = lk_soa_column(soa, uint64_t, 0);
+    start            = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        sum += column[i];
+    }
+    end = now_ns();
+    print_result("soa_field_scan", RECORD_SIZE, n, 1, end - start, n, 0);
+
+    sink = (unsigned char)sum;
+    lk_free_array(aos);
+    lk_free_soa(soa);
+}
+
+#define QUEUE_DEPTH 1024
+
+// Work queue of QUEUE_DEPTH elements: every op enqueues one and dequeues one.
+static void bench_queues(size_t ops) {
+    unsigned char element[256];
+    memset(element, 0xab, sizeof(element));
+
+    for (size_t m = 0; m < sizeof(memb_sizes) / sizeof(memb_sizes[0]); ++m) {
+        size_t    memb_size = memb_sizes[m];
+        lk_ring*  ring      = lk_new_ring(memb_size, QUEUE_DEPTH);
+        lk_array* arr       = lk_new_array(0, memb_size);
+        for (size_t i = 0; i < QUEUE_DEPTH; ++i) {
+            lk_ring_push_back(ring, element);
+            lk_push_back(arr, element);
+        }
+
+        double start = now_ns();
+        for (size_t i = 0; i < ops; ++i) {
+            lk_ring_pop_front(ring, element);
+            lk_ring_push_back(ring, element);
+        }
+        double end = now_ns();
+        print_result("ring_queue", memb_size, QUEUE_DEPTH, 1, end - start, ops, 2 * ops * memb_size);
+
+        // the front of an lk_array can only be removed by moving the rest
+        start = now_ns();
+        for (size_t i = 0; i < ops; ++i) {
+            lk_erase_range(arr, 0, 1);
+            lk_push_back(arr, element);
+        }
+        end = now_ns();
+        print_result("array_queue", memb_size, QUEUE_DEPTH, 1, end - start, ops,
+            ops * QUEUE_DEPTH * memb_size);
+
+        lk_free_ring(ring);
+        lk_free_array(arr);
+    }
+}
+
+struct producer {
+    lk_concurrent_array* arr;
+    size_t               count;
+};
+
+static void* producer_main(void* arg) {
+    struct producer* p = arg;
+    for (uint64_t i = 0; i < p->count; ++i) {
+        lk_concurrent_push_back(p->arr, &i);
+    }
+    return NULL;
+}
+
+static void bench_concurrent_push_back(size_t elements, size_t max_threads) {
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        lk_concurrent_array* arr = lk_new_concurrent_array(sizeof(uint64_t), 0);
+        pthread_t*           ids = malloc(threads * sizeof(pthread_t));
+        struct producer      p   = { arr, elements / threads };
+
+        double start = now_ns();
+        for (size_t i = 0; i < threads; ++i) {
+            pthread_create(&ids[i], NULL, producer_main, &p);
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            pthread_join(ids[i], NULL);
+        }
+        double end = now_ns();
+
+        size_t ops = p.count * threads;
+        print_result("concurrent_push_back", sizeof(uint64_t), ops, threads, end - start, ops,
+            ops * sizeof(uint64_t));
+        free(ids);
+        lk_free_concurrent_array(arr);
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            // always measure max_threads itself
+            threads = max_threads / 2;
+        }
+    }
+}
+
+static void sum_u64(void* acc, const void* first, size_t count, void* ctx) {
+    (void)ctx;
+    const uint64_t* values = first;
+    uint64_t        sum    = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += values[i];
+    }
+    *(uint64_t*)acc += sum;
+}
+
+static void add_u64(void* acc, const void* other, void* ctx) {
+    (void)ctx;
+    *(uint64_t*)acc += *(const uint64_t*)other;
+}
+
+// Measures how copy, fill and reduce scale from 1 to max_threads threads.
+// The destination is written once before timing, so page faults aren't
+// counted.
+static void bench_parallel(size_t elements, size_t max_threads) {
+    lk_array* arr  = lk_new_array(elements, sizeof(uint64_t));
+    lk_array* copy = lk_new_array(0, sizeof(uint64_t));
+    uint64_t  zero = 0;
+    uint64_t  sum  = 0;
+    lk_parallel_copy(copy, arr);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        lk_parallel_set_threads(threads);
+        size_t bytes = elements * sizeof(uint64_t);
+
+        double start = now_ns();
+        lk_parallel_copy(copy, arr);
+        double end = now_ns();
+        print_result("parallel_copy", sizeof(uint64_t), elements, threads, end - start, elements, bytes);
+
+        uint64_t value = threads;
+        start          = now_ns();
+        lk_parallel_fill(copy, &value);
+        end = now_ns();
+        print_result("parallel_fill", sizeof(uint64_t), elements, threads, end - start, elements, 0);
+
+        start = now_ns();
+        lk_parallel_reduce(copy, &sum, sizeof(sum), &zero, sum_u64, add_u64, NULL);
+        end  = now_ns();
+        sink = (unsigned char)sum;
+        print_result("parallel_reduce", sizeof(uint64_t), elements, threads, end - start, elements, 0);
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            // always measure max_threads itself
+            threads = max_threads / 2;
+        }
+    }
+
+    lk_parallel_shutdown();
+    lk_free_array(copy);
+    lk_free_array(arr);
+}
+
+// Compares loading a serialized array by reading it into a new array with
+// mapping it, with and without checking the checksum. The file is in the
+// page cache, so this measures the copy, not the disk.
+static void bench_serial(size_t elements) {
+    char path[] = "/tmp/lk_serial_bench_XXXXXX";
+    int  fd     = mkstemp(path);
+    if (fd < 0) {
+        return;
+    }
+
+    lk_array* arr   = lk_new_array(elements, sizeof(uint64_t));
+    size_t    bytes = elements * sizeof(uint64_t);
+    double    start = now_ns();
+    lk_serial_write_fd(arr, fd, 4096);
+    double end = now_ns();
+    print_result("serial_write", sizeof(uint64_t), elements, 1, end - start, elements, bytes);
+
+    lseek(fd, 0, SEEK_SET);
+    start            = now_ns();
+    lk_array* loaded = lk_serial_read_fd(fd);
+    end              = now_ns();
+    print_result("serial_read", sizeof(uint64_t), elements, 1, end - start, elements, bytes);
+    lk_free_array(loaded);
+    close(fd);
+
+    for (int verify = 0; verify <= 1; ++verify) {
+        start                      = now_ns();
+        lk_serial_mapping* mapping = lk_serial_map(path, verify);
+        end                        = now_ns();
+        print_result(verify ? "serial_map_verify" : "serial_map", sizeof(uint64_t), elements, 1, end - start,
+            elements, 0);
+        lk_serial_unmap(mapping);
+    }
+
+    unlink(path);
+    lk_free_array(arr);
+}
+
+// Compares reading a file of elements into a scratch buffer and pushing
+// them one at a time with lk_append_from_fd reading into the array.
+static void bench_fd_ingest(size_t memb_size, size_t n) {
+    char path[] = "/tmp/lk_fd_bench_XXXXXX";
+    int  fd     = mkstemp(path);
+    if (fd < 0) {
+        return;
+    }
+
+    lk_array* arr = lk_new_array(n, memb_size);
+    lk_write_to_fd(arr, fd);
+    lk_free_array(arr);
+
+    lseek(fd, 0, SEEK_SET);
+    arr                   = lk_new_array(0, memb_size);
+    unsigned char* buffer = malloc(LK_FD_READ_BYTES);
+    size_t         filled = 0;
+    double         start  = now_ns();
+    for (;;) {
+        ssize_t got = read(fd, buffer + filled, LK_FD_READ_BYTES - filled);
+        if (got <= 0) {
+            break;
+        }
+        filled += (size_t)got;
+        size_t whole = filled / memb_size;
+        for (size_t i = 0; i < whole; ++i) {
+            lk_push_back(arr, buffer + i * memb_size);
+        }
+        memmove(buffer, buffer + whole * memb_size, filled - whole * memb_size);
+        filled -= whole * memb_size;
+    }
+    double end = now_ns();
+    print_result("read_push_back", memb_size, n, 1, end - start, n, n * memb_size);
+    free(buffer);
+    lk_free_array(arr);
+
+    lseek(fd, 0, SEEK_SET);
+    arr                  = lk_new_array(0, memb_size);
+    lk_fd_reader* reader = lk_new_fd_reader(fd, memb_size);
+    start                = now_ns();
+    while (!reader->eof && lk_append_from_fd(arr, reader, NULL)) {
+    }
+    end = now_ns();
+    print_result("append_from_fd", memb_size, n, 1, end - start, n, n * memb_size);
+    lk_free_fd_reader(reader);
+    lk_free_array(arr);
+
+    close(fd);
+    unlink(path);
+}
+
+// Dedups n keys, of which about half are repeats, once with a hash set and
+// once by scanning the unique keys so far with lk_find.
+static void bench_dedup(size_t n, bool linear) {
+    uint64_t  state  = 88172645463325252ull;
+    lk_array* keys   = lk_new_array(n, sizeof(uint64_t));
+    lk_array* unique = lk_new_array(0, sizeof(uint64_t));
+    for (size_t i = 0; i < n; ++i) {
+        *lk_at(keys, uint64_t, i) = xorshift(&state) % (n / 2 + 1);
+    }
+
+    lk_hash_map* set   = lk_new_hash_set(sizeof(uint64_t), NULL, NULL);
+    double       start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        lk_hash_insert(set, lk_at(keys, uint64_t, i), NULL, NULL);
+    }
+    double end = now_ns();
+    print_result("hash_dedup", sizeof(uint64_t), n, 1, end - start, n, 0);
+
+    size_t hits = 0;
+    start       = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        hits += lk_hash_contains(set, lk_at(keys, uint64_t, i));
+    }
+    end  = now_ns();
+    sink = (unsigned char)hits;
+    print_result("hash_find", sizeof(uint64_t), n, 1, end - start, n, 0);
+    lk_free_hash_map(set);
+
+    if (linear) {
+        start = now_ns();
+        for (size_t i = 0; i < n; ++i) {
+            if (!lk_find(unique, lk_at(keys, uint64_t, i), NULL)) {
+                lk_push_back(unique, lk_at(keys, uint64_t, i));
+            }
+        }
+        end = now_ns();
+        print_result("linear_dedup", sizeof(uint64_t), n, 1, end - start, n, 0);
+    }
+
+    lk_free_array(unique);
+    lk_free_array(keys);
+}
+
+int main(int argc, char** argv) {
+    size_t max_bytes = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : (size_t)64 << 20;
+    long   cpus      = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads   = cpus > 0 ? (size_t)cpus : 1;
+
+    lk_setup_error_callback_stderr();
+    print_header();
+
+    bench_array_sizes(max_bytes);
+    bench_record_scan(max_bytes / RECORD_SIZE);
+    bench_queues((size_t)1 << 16);
+    bench_parallel(max_bytes / sizeof(uint64_t), threads);
+    bench_serial(max_bytes / sizeof(uint64_t));
+    bench_fd_ingest(RECORD_SIZE, max_bytes / RECORD_SIZE);
+    bench_dedup((size_t)1 << 12, true);
+    bench_dedup(max_bytes / sizeof(uint64_t), false);
+    bench_concurrent_push_back((size_t)1 << 22, threads);
+
+    return 0;
+}
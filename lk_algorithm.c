@@ -0,0 +1,563 @@
+#include "lk_algorithm.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(LK_NO_SIMD)
+#define LK_X86_SIMD
+#include <immintrin.h>
+#endif // __x86_64__
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+// Runs shorter than this are insertion sorted before merging.
+#define INSERTION_RUN 32
+
+// Checks the arguments shared by all functions here.
+static bool check_args(lk_array* arr, const void* key, bool needs_key, lk_compare_fn cmp) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (needs_key && !key) {
+        report_error(LK_ERR_NULL, "key cannot be NULL");
+        return false;
+    }
+
+    if (!cmp) {
+        report_error(LK_ERR_NULL, "cmp cannot be NULL");
+        return false;
+    }
+
+    return true;
+}
+
+bool lk_sort(lk_array* arr, lk_compare_fn cmp) {
+    if (!check_args(arr, NULL, false, cmp)) {
+        return false;
+    }
+
+    if (arr->size < 2) {
+        return true;
+    }
+
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    qsort(arr->data, arr->size, arr->memb_size, cmp);
+
+    return true;
+}
+
+// Insertion sorts n elements at data. tmp has room for one element.
+static void insertion_sort(char* data, size_t n, size_t memb_size, lk_compare_fn cmp, char* tmp) {
+    for (size_t i = 1; i < n; ++i) {
+        char*  elem = data + i * memb_size;
+        size_t j    = i;
+        while (j > 0 && cmp(data + (j - 1) * memb_size, elem) > 0) {
+            --j;
+        }
+        if (j != i) {
+            memcpy(tmp, elem, memb_size);
+            memmove(data + (j + 1) * memb_size, data + j * memb_size, (i - j) * memb_size);
+            memcpy(data + j * memb_size, tmp, memb_size);
+        }
+    }
+}
+
+// Merges the sorted runs [left, mid) and [mid, right) of src into dst.
+static void merge(const char* src, char* dst, size_t left, size_t mid, size_t right, size_t memb_size,
+    lk_compare_fn cmp) {
+    size_t i = left;
+    size_t j = mid;
+    size_t k = left;
+    while (i < mid && j < right) {
+        // taking from the left run on ties keeps the sort stable
+        if (cmp(src + j * memb_size, src + i * memb_size) < 0) {
+            memcpy(dst + k++ * memb_size, src + j++ * memb_size, memb_size);
+        } else {
+            memcpy(dst + k++ * memb_size, src + i++ * memb_size, memb_size);
+        }
+    }
+    memcpy(dst + k * memb_size, src + i * memb_size, (mid - i) * memb_size);
+    k += mid - i;
+    memcpy(dst + k * memb_size, src + j * memb_size, (right - j) * memb_size);
+}
+
+bool lk_stable_sort(lk_array* arr, lk_compare_fn cmp) {
+    if (!check_args(arr, NULL, false, cmp)) {
+        return false;
+    }
+
+    size_t n         = arr->size;
+    size_t memb_size = arr->memb_size;
+    if (n < 2) {
+        return true;
+    }
+
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    // one more element as temporary for insertion_sort
+    char* buf = LK_REALLOCARRAY(NULL, n + 1, memb_size);
+    if (!buf) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+
+    char* src = arr->data;
+    char* dst = buf;
+    for (size_t i = 0; i < n; i += INSERTION_RUN) {
+        size_t run = n - i < INSERTION_RUN ? n - i : INSERTION_RUN;
+        insertion_sort(src + i * memb_size, run, memb_size, cmp, buf + n * memb_size);
+    }
+
+    for (size_t width = INSERTION_RUN; width < n; width *= 2) {
+        for (size_t left = 0; left < n; left += 2 * width) {
+            size_t mid   = n - left < width ? n : left + width;
+            size_t right = n - mid < width ? n : mid + width;
+            merge(src, dst, left, mid, right, memb_size, cmp);
+        }
+        char* tmp = src;
+        src       = dst;
+        dst       = tmp;
+    }
+
+    if (src != arr->data) {
+        memcpy(arr->data, src, n * memb_size);
+    }
+    LK_FREE(buf);
+
+    return true;
+}
+
+// Reads the key of elem as an unsigned integer that sorts like the key.
+static uint64_t read_key(const char* elem, size_t key_size, bool is_signed) {
+    uint64_t key;
+    switch (key_size) {
+    case 1: {
+        uint8_t k;
+        memcpy(&k, elem, 1);
+        key = k;
+        break;
+    }
+    case 2: {
+        uint16_t k;
+        memcpy(&k, elem, 2);
+        key = k;
+        break;
+    }
+    case 4: {
+        uint32_t k;
+        memcpy(&k, elem, 4);
+        key = k;
+        break;
+    }
+    default: {
+        memcpy(&key, elem, 8);
+        break;
+    }
+    }
+    if (is_signed) {
+        // flipping the sign bit maps the signed range onto the unsigned one
+        key ^= (uint64_t)1 << (key_size * 8 - 1);
+    }
+    return key;
+}
+
+bool lk_radix_sort(lk_array* arr, size_t key_offset, size_t key_size, bool is_signed) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (key_size != 1 && key_size != 2 && key_size != 4 && key_size != 8) {
+        report_error(LK_ERR_INVALID_ARG, "key_size has to be 1, 2, 4 or 8");
+        return false;
+    }
+
+    if (key_offset > arr->memb_size || key_size > arr->memb_size - key_offset) {
+        report_error(LK_ERR_INVALID_ARG, "key does not fit into an element");
+        return false;
+    }
+
+    size_t n         = arr->size;
+    size_t memb_size = arr->memb_size;
+    if (n < 2) {
+        return true;
+    }
+
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    // counts for every byte of the key, gathered in a single pass
+    size_t* counts = LK_CALLOC(key_size * 256, sizeof(size_t));
+    char*   buf    = LK_REALLOCARRAY(NULL, n, memb_size);
+    if (!counts || !buf) {
+        LK_FREE(counts);
+        LK_FREE(buf);
+        report_error(LK_ERR_ALLOC, "allocation of temporary buffers failed");
+        return false;
+    }
+
+    char* src = arr->data;
+    char* dst = buf;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = read_key(src + i * memb_size + key_offset, key_size, is_signed);
+        for (size_t b = 0; b < key_size; ++b) {
+            ++counts[b * 256 + ((key >> (b * 8)) & 0xff)];
+        }
+    }
+
+    for (size_t b = 0; b < key_size; ++b) {
+        size_t* count = counts + b * 256;
+        // if all keys share this byte, the pass wouldn't change anything
+        if (count[(read_key(src + key_offset, key_size, is_signed) >> (b * 8)) & 0xff] == n) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t d = 0; d < 256; ++d) {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            char*    elem = src + i * memb_size;
+            uint64_t key  = read_key(elem + key_offset, key_size, is_signed);
+            memcpy(dst + count[(key >> (b * 8)) & 0xff]++ * memb_size, elem, memb_size);
+        }
+
+        char* tmp = src;
+        src       = dst;
+        dst       = tmp;
+    }
+
+    if (src != arr->data) {
+        memcpy(arr->data, src, n * memb_size);
+    }
+    LK_FREE(counts);
+    LK_FREE(buf);
+
+    return true;
+}
+
+// Returns the first index in arr whose element is not before key, where
+// an element is before key if cmp(elem, key) < 0 (or <= 0 if upper).
+static size_t partition_point(lk_array* arr, const void* key, lk_compare_fn cmp, bool upper) {
+    size_t      first = 0;
+    size_t      count = arr->size;
+    const char* data  = arr->data;
+    while (count > 0) {
+        size_t half = count / 2;
+        int    c    = cmp(data + (first + half) * arr->memb_size, key);
+        if (c < 0 || (upper && c == 0)) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+size_t lk_lower_bound(lk_array* arr, const void* key, lk_compare_fn cmp) {
+    if (!check_args(arr, key, true, cmp)) {
+        return 0;
+    }
+
+    return partition_point(arr, key, cmp, false);
+}
+
+size_t lk_upper_bound(lk_array* arr, const void* key, lk_compare_fn cmp) {
+    if (!check_args(arr, key, true, cmp)) {
+        return 0;
+    }
+
+    return partition_point(arr, key, cmp, true);
+}
+
+bool lk_binary_search(lk_array* arr, const void* key, lk_compare_fn cmp, size_t* index) {
+    if (!check_args(arr, key, true, cmp)) {
+        return false;
+    }
+
+    size_t i = partition_point(arr, key, cmp, false);
+    if (i == arr->size || cmp((char*)arr->data + i * arr->memb_size, key) != 0) {
+        return false;
+    }
+
+    if (index) {
+        *index = i;
+    }
+
+    return true;
+}
+
+// Scans bytes bytes of elements of w bytes at data for value. If count is
+// NULL, returns the offset of the first match, otherwise adds the number of
+// matches to *count. Returns bytes if nothing was found.
+typedef size_t (*scan_fn)(const char* data, size_t bytes, const char* value, size_t w, size_t* count);
+
+static size_t scan_scalar(const char* data, size_t bytes, const char* value, size_t w, size_t* count) {
+    if (w == 1 && !count) {
+        const char* match = memchr(data, *value, bytes);
+        return match ? (size_t)(match - data) : bytes;
+    }
+
+    for (size_t i = 0; i < bytes; i += w) {
+        bool equal;
+        switch (w) {
+        case 4: {
+            uint32_t a;
+            uint32_t b;
+            memcpy(&a, data + i, 4);
+            memcpy(&b, value, 4);
+            equal = a == b;
+            break;
+        }
+        case 8: {
+            uint64_t a;
+            uint64_t b;
+            memcpy(&a, data + i, 8);
+            memcpy(&b, value, 8);
+            equal = a == b;
+            break;
+        }
+        default:
+            equal = memcmp(data + i, value, w) == 0;
+            break;
+        }
+        if (equal) {
+            if (!count) {
+                return i;
+            }
+            ++*count;
+        }
+    }
+    return bytes;
+}
+
+#ifdef LK_X86_SIMD
+
+// Turns a mask of matching bytes into one with a bit at the first byte of
+// every element of w bytes whose bytes all match.
+static inline uint64_t element_mask(uint64_t m, size_t w) {
+    for (size_t s = 1; s < w; s <<= 1) {
+        m &= m >> s;
+    }
+    // a bit at every multiple of w
+    return m & (~(uint64_t)0 / ((~(uint64_t)0) >> (64 - w)));
+}
+
+// Adds the matches in the byte mask m at offset i, or returns true and
+// stores the offset of the first one in found if not counting.
+static inline bool handle_mask(uint64_t m, size_t w, size_t i, size_t* count, size_t* found) {
+    m = element_mask(m, w);
+    if (!m) {
+        return false;
+    }
+    if (!count) {
+        *found = i + (size_t)__builtin_ctzll(m);
+        return true;
+    }
+    *count += (size_t)__builtin_popcountll(m);
+    return false;
+}
+
+// The kernels compare whole vectors bytewise against value repeated, and
+// leave the tail shorter than a vector to scan_scalar. pattern holds value
+// repeated to 64 bytes.
+#define SCAN_TAIL()                                                            \
+    do {                                                                       \
+        size_t rest = scan_scalar(data + i, bytes - i, pattern, w, count);     \
+        return rest == bytes - i ? bytes : i + rest;                           \
+    } while (0)
+
+__attribute__((target("sse2"))) static size_t scan_sse2(const char* data, size_t bytes, const char* pattern,
+    size_t w, size_t* count) {
+    __m128i p     = _mm_loadu_si128((const __m128i*)pattern);
+    size_t  i     = 0;
+    size_t  found = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        if (handle_mask((uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, p)), w, i, count, &found)) {
+            return found;
+        }
+    }
+    SCAN_TAIL();
+}
+
+__attribute__((target("avx2"))) static size_t scan_avx2(const char* data, size_t bytes, const char* pattern,
+    size_t w, size_t* count) {
+    __m256i p     = _mm256_loadu_si256((const __m256i*)pattern);
+    size_t  i     = 0;
+    size_t  found = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        if (handle_mask((uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, p)), w, i, count, &found)) {
+            return found;
+        }
+    }
+    SCAN_TAIL();
+}
+
+__attribute__((target("avx512f,avx512bw"))) static size_t scan_avx512(const char* data, size_t bytes,
+    const char* pattern, size_t w, size_t* count) {
+    __m512i p     = _mm512_loadu_si512((const void*)pattern);
+    size_t  i     = 0;
+    size_t  found = 0;
+    for (; i + 64 <= bytes; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(data + i));
+        if (handle_mask((uint64_t)_mm512_cmpeq_epi8_mask(v, p), w, i, count, &found)) {
+            return found;
+        }
+    }
+    SCAN_TAIL();
+}
+
+#undef SCAN_TAIL
+
+#endif // LK_X86_SIMD
+
+// Returns the fastest scan kernel for elements of w bytes on this CPU.
+static scan_fn select_scan(size_t w) {
+    if (w != 1 && w != 2 && w != 4 && w != 8 && w != 16) {
+        return scan_scalar;
+    }
+#ifdef LK_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        return scan_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return scan_avx2;
+    }
+    return scan_sse2;
+#else
+    return scan_scalar;
+#endif // LK_X86_SIMD
+}
+
+// Repeats value of w bytes to fill pattern. w has to divide 64.
+static void make_pattern(char pattern[64], const void* value, size_t w) {
+    for (size_t i = 0; i < 64; i += w) {
+        memcpy(pattern + i, value, w);
+    }
+}
+
+bool lk_find(lk_array* arr, const void* value, size_t* index) {
+    if (!arr || !value) {
+        report_error(LK_ERR_NULL, "arr and value cannot be NULL");
+        return false;
+    }
+
+    size_t w     = arr->memb_size;
+    size_t bytes = arr->size * w;
+    if (bytes == 0) {
+        return false;
+    }
+
+    const char* needle = value;
+    char        pattern[64];
+    if (64 % w == 0) {
+        make_pattern(pattern, value, w);
+        needle = pattern;
+    }
+
+    size_t at = select_scan(w)(arr->data, bytes, needle, w, NULL);
+    if (at == bytes) {
+        return false;
+    }
+
+    if (index) {
+        *index = at / w;
+    }
+
+    return true;
+}
+
+size_t lk_count(lk_array* arr, const void* value) {
+    if (!arr || !value) {
+        report_error(LK_ERR_NULL, "arr and value cannot be NULL");
+        return 0;
+    }
+
+    size_t w     = arr->memb_size;
+    size_t count = 0;
+    if (arr->size == 0) {
+        return 0;
+    }
+
+    const char* needle = value;
+    char        pattern[64];
+    if (64 % w == 0) {
+        make_pattern(pattern, value, w);
+        needle = pattern;
+    }
+
+    select_scan(w)(arr->data, arr->size * w, needle, w, &count);
+
+    return count;
+}
+
+bool lk_fill(lk_array* arr, const void* value) {
+    if (!arr || !value) {
+        report_error(LK_ERR_NULL, "arr and value cannot be NULL");
+        return false;
+    }
+
+    size_t w     = arr->memb_size;
+    size_t bytes = arr->size * w;
+    if (bytes == 0) {
+        return true;
+    }
+
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    char* data = arr->data;
+    if (64 % w == 0) {
+        // fixed size copies of the pattern compile to plain vector stores
+        char pattern[64];
+        make_pattern(pattern, value, w);
+        size_t i = 0;
+        for (; i + 64 <= bytes; i += 64) {
+            memcpy(data + i, pattern, 64);
+        }
+        memcpy(data + i, pattern, bytes - i);
+        return true;
+    }
+
+    // copy the filled part onto the rest, doubling it every time
+    memcpy(data, value, w);
+    for (size_t filled = w; filled < bytes; filled *= 2) {
+        memcpy(data + filled, data, filled < bytes - filled ? filled : bytes - filled);
+    }
+
+    return true;
+}
+
+bool lk_equal(lk_array* a, lk_array* b) {
+    if (!a || !b) {
+        report_error(LK_ERR_NULL, "arrays cannot be NULL");
+        return false;
+    }
+
+    if (a->memb_size != b->memb_size || a->size != b->size) {
+        return false;
+    }
+
+    // libc's memcmp is already vectorized and dispatched at runtime
+    return a->size == 0 || memcmp(a->data, b->data, a->size * a->memb_size) == 0;
+}
@@ -0,0 +1,76 @@
+#ifndef LK_ALGORITHM_H
+#define LK_ALGORITHM_H
+
+/*
+ * lk_algorithm.h
+ *
+ * Defines sorting, searching and other whole-array functions for lk_arrays.
+ *
+ * Comparators get pointers to two elements and return a negative number,
+ * zero or a positive number if the first is less than, equal to or greater
+ * than the second, like for qsort. For the search functions, the second
+ * argument is always the key that was passed in.
+ *
+ * lk_radix_sort sorts by an integer key stored inside the elements without
+ * calling a comparator at all, which is a lot faster for large arrays.
+ *
+ * lk_find and lk_count compare elements bytewise. For elements of 1, 2, 4,
+ * 8 or 16 bytes on x86-64 they use SSE2, AVX2 or AVX-512 kernels, chosen at
+ * runtime by what the CPU supports. Define LK_NO_SIMD to always use the
+ * scalar loops.
+ *
+ * Sorting and filling modify the array, so it is unshared first
+ * (see lk_array_share).
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+/// Comparator for sorting and searching, see above.
+typedef int (*lk_compare_fn)(const void* a, const void* b);
+
+/// Sorts arr in ascending order according to cmp.
+/// The order of equal elements is unspecified.
+bool lk_sort(lk_array* arr, lk_compare_fn cmp);
+
+/// Sorts arr in ascending order according to cmp, keeping equal elements
+/// in their original order. Needs a temporary buffer of arr's size.
+bool lk_stable_sort(lk_array* arr, lk_compare_fn cmp);
+
+/// Stable sort by an integer key of key_size bytes (1, 2, 4 or 8) at byte
+/// offset key_offset inside each element, in the machine's byte order.
+/// If is_signed is true the key is a two's complement signed integer.
+/// Needs a temporary buffer of arr's size.
+bool lk_radix_sort(lk_array* arr, size_t key_offset, size_t key_size, bool is_signed);
+
+/// Returns the index of the first element of the sorted arr that is not
+/// less than key, or arr->size if there is none.
+/// Returns 0 on error.
+size_t lk_lower_bound(lk_array* arr, const void* key, lk_compare_fn cmp);
+
+/// Returns the index of the first element of the sorted arr that is
+/// greater than key, or arr->size if there is none.
+/// Returns 0 on error.
+size_t lk_upper_bound(lk_array* arr, const void* key, lk_compare_fn cmp);
+
+/// Returns true if the sorted arr contains an element equal to key, and
+/// stores the index of the first such element in index (if not NULL).
+bool lk_binary_search(lk_array* arr, const void* key, lk_compare_fn cmp, size_t* index);
+
+/// Returns true if arr contains an element whose bytes equal those of
+/// value, and stores the index of the first such element in index
+/// (if not NULL).
+bool lk_find(lk_array* arr, const void* value, size_t* index);
+
+/// Returns the number of elements of arr whose bytes equal those of value.
+/// Returns 0 on error.
+size_t lk_count(lk_array* arr, const void* value);
+
+/// Sets every element of arr to value.
+bool lk_fill(lk_array* arr, const void* value);
+
+/// Returns true if a and b have the same member size and size, and their
+/// elements are bytewise equal.
+bool lk_equal(lk_array* a, lk_array* b);
+
+#endif // LK_ALGORITHM_H
@@ -0,0 +1,539 @@
+#define _GNU_SOURCE
+#include "lk_allocator.h"
+#include "lk_array.h"
+#include <string.h>
+#include <stdalign.h>
+#include <stdint.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LK_HAVE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // __unix__
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+struct lk_arena_chunk {
+    lk_arena_chunk* next;
+    size_t          capacity;
+    size_t          used;
+    max_align_t     data[];
+};
+
+// rounds size up to the alignment of max_align_t
+static size_t align_up(size_t size) {
+    const size_t align = alignof(max_align_t);
+    return (size + align - 1) & ~(align - 1);
+}
+
+static lk_arena_chunk* new_chunk(size_t capacity) {
+    lk_arena_chunk* chunk = LK_MALLOC(sizeof(lk_arena_chunk) + capacity);
+    if (!chunk) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+    chunk->next     = NULL;
+    chunk->capacity = capacity;
+    chunk->used     = 0;
+    return chunk;
+}
+
+static void* arena_alloc(void* ctx, size_t size) {
+    lk_arena* arena = ctx;
+
+    if (size > SIZE_MAX - alignof(max_align_t)) {
+        report_error(LK_ERR_INVALID_ARG, "size too large");
+        return NULL;
+    }
+    size = align_up(size);
+
+    lk_arena_chunk* chunk = arena->head;
+    if (!chunk || chunk->capacity - chunk->used < size) {
+        chunk = new_chunk(size > arena->chunk_size ? size : arena->chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+
+    void* ptr = (char*)chunk->data + chunk->used;
+    chunk->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+static void* arena_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    lk_arena* arena = ctx;
+
+    if (!ptr) {
+        return arena_alloc(ctx, new_size);
+    }
+
+    // the most recent allocation can grow or shrink in place
+    lk_arena_chunk* chunk = arena->head;
+    if (ptr == arena->last && new_size <= SIZE_MAX - alignof(max_align_t)) {
+        size_t offset = (size_t)((char*)ptr - (char*)chunk->data);
+        size_t size   = align_up(new_size);
+        if (size <= chunk->capacity - offset) {
+            chunk->used = offset + size;
+            return ptr;
+        }
+    }
+
+    void* new_ptr = arena_alloc(ctx, new_size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    return new_ptr;
+}
+
+static void arena_free(void* ctx, void* ptr, size_t size) {
+    (void)size;
+    lk_arena* arena = ctx;
+
+    // only the most recent allocation can be given back
+    if (ptr && ptr == arena->last) {
+        arena->head->used = (size_t)((char*)ptr - (char*)arena->head->data);
+        arena->last       = NULL;
+    }
+}
+
+bool lk_arena_init(lk_arena* arena, size_t chunk_size) {
+    if (!arena) {
+        report_error(LK_ERR_NULL, "arena cannot be NULL");
+        return false;
+    }
+
+    if (chunk_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "chunk_size may never be 0");
+        return false;
+    }
+
+    arena->head                   = NULL;
+    arena->chunk_size             = align_up(chunk_size);
+    arena->last                   = NULL;
+    arena->allocator.alloc        = arena_alloc;
+    arena->allocator.realloc      = arena_realloc;
+    arena->allocator.free         = arena_free;
+    arena->allocator.ctx          = arena;
+    arena->allocator.alloc_zeroed = NULL;
+
+    return true;
+}
+
+lk_allocator* lk_arena_allocator(lk_arena* arena) {
+    if (!arena) {
+        report_error(LK_ERR_NULL, "arena cannot be NULL");
+        return NULL;
+    }
+
+    return &arena->allocator;
+}
+
+void lk_arena_reset(lk_arena* arena) {
+    if (!arena || !arena->head) {
+        return;
+    }
+
+    // keep the most recent chunk, it's likely to be a regular sized one
+    lk_arena_chunk* chunk = arena->head->next;
+    while (chunk) {
+        lk_arena_chunk* next = chunk->next;
+        LK_FREE(chunk);
+        chunk = next;
+    }
+    arena->head->next = NULL;
+    arena->head->used = 0;
+    arena->last       = NULL;
+}
+
+void lk_arena_destroy(lk_arena* arena) {
+    if (!arena) {
+        return;
+    }
+
+    lk_arena_chunk* chunk = arena->head;
+    while (chunk) {
+        lk_arena_chunk* next = chunk->next;
+        LK_FREE(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->last = NULL;
+}
+
+// returns the size class for size, or LK_POOL_CLASSES if it's too large
+static size_t size_class(size_t size) {
+    size_t class      = 0;
+    size_t class_size = 16;
+    while (class < LK_POOL_CLASSES && class_size < size) {
+        ++class;
+        class_size <<= 1;
+    }
+    return class;
+}
+
+static void* pool_alloc(void* ctx, size_t size) {
+    lk_pool* pool  = ctx;
+    size_t   class = size_class(size);
+
+    if (class == LK_POOL_CLASSES) {
+        void* ptr = LK_MALLOC(size);
+        if (!ptr) {
+            report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        }
+        return ptr;
+    }
+
+    void* block = pool->free_lists[class];
+    if (block) {
+        // the first bytes of a free block point to the next free block
+        pool->free_lists[class] = *(void**)block;
+        return block;
+    }
+
+    return arena_alloc(&pool->slabs, (size_t)16 << class);
+}
+
+static void pool_free(void* ctx, void* ptr, size_t size) {
+    lk_pool* pool  = ctx;
+    size_t   class = size_class(size);
+
+    if (!ptr) {
+        return;
+    }
+
+    if (class == LK_POOL_CLASSES) {
+        LK_FREE(ptr);
+        return;
+    }
+
+    *(void**)ptr            = pool->free_lists[class];
+    pool->free_lists[class] = ptr;
+}
+
+static void* pool_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    if (!ptr) {
+        return pool_alloc(ctx, new_size);
+    }
+
+    size_t old_class = size_class(old_size);
+    size_t new_class = size_class(new_size);
+
+    if (old_class == new_class && new_class < LK_POOL_CLASSES) {
+        // still fits the same block
+        return ptr;
+    }
+
+    if (old_class == LK_POOL_CLASSES && new_class == LK_POOL_CLASSES) {
+        void* new_ptr = LK_REALLOC(ptr, new_size);
+        if (!new_ptr) {
+            report_error(LK_ERR_ALLOC, "LK_REALLOC failed");
+        }
+        return new_ptr;
+    }
+
+    void* new_ptr = pool_alloc(ctx, new_size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    pool_free(ctx, ptr, old_size);
+    return new_ptr;
+}
+
+bool lk_pool_init(lk_pool* pool, size_t slab_size) {
+    if (!pool) {
+        report_error(LK_ERR_NULL, "pool cannot be NULL");
+        return false;
+    }
+
+    if (!lk_arena_init(&pool->slabs, slab_size)) {
+        report_error(LK_ERR_INVALID_ARG, "lk_arena_init failed");
+        return false;
+    }
+
+    for (size_t i = 0; i < LK_POOL_CLASSES; ++i) {
+        pool->free_lists[i] = NULL;
+    }
+    pool->allocator.alloc        = pool_alloc;
+    pool->allocator.realloc      = pool_realloc;
+    pool->allocator.free         = pool_free;
+    pool->allocator.ctx          = pool;
+    pool->allocator.alloc_zeroed = NULL;
+
+    return true;
+}
+
+lk_allocator* lk_pool_allocator(lk_pool* pool) {
+    if (!pool) {
+        report_error(LK_ERR_NULL, "pool cannot be NULL");
+        return NULL;
+    }
+
+    return &pool->allocator;
+}
+
+void lk_pool_destroy(lk_pool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    lk_arena_destroy(&pool->slabs);
+    for (size_t i = 0; i < LK_POOL_CLASSES; ++i) {
+        pool->free_lists[i] = NULL;
+    }
+}
+
+// Blocks of lk_aligned below huge_threshold are carved out of an LK_MALLOC'd
+// block with room for the alignment. The pointer to that block is stored
+// right before the aligned one.
+static size_t small_padding(lk_aligned* aligned) {
+    return aligned->alignment - 1 + sizeof(void*);
+}
+
+// Returns the first aligned address in raw with room for the pointer to raw.
+static char* aligned_address(lk_aligned* aligned, char* raw) {
+    uintptr_t addr = (uintptr_t)(raw + sizeof(void*));
+    addr           = (addr + aligned->alignment - 1) & ~(uintptr_t)(aligned->alignment - 1);
+    return (char*)addr;
+}
+
+static char* align_block(lk_aligned* aligned, char* raw) {
+    char* ptr = aligned_address(aligned, raw);
+    memcpy(ptr - sizeof(void*), &raw, sizeof(void*));
+    return ptr;
+}
+
+static char* raw_block(char* ptr) {
+    char* raw;
+    memcpy(&raw, ptr - sizeof(void*), sizeof(void*));
+    return raw;
+}
+
+static void* small_alloc(lk_aligned* aligned, size_t size) {
+    if (size > SIZE_MAX - small_padding(aligned)) {
+        report_error(LK_ERR_INVALID_ARG, "size too large");
+        return NULL;
+    }
+
+    char* raw = LK_MALLOC(size + small_padding(aligned));
+    if (!raw) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+    return align_block(aligned, raw);
+}
+
+static void* small_realloc(lk_aligned* aligned, char* ptr, size_t old_size, size_t new_size) {
+    if (new_size > SIZE_MAX - small_padding(aligned)) {
+        report_error(LK_ERR_INVALID_ARG, "size too large");
+        return NULL;
+    }
+
+    // LK_REALLOC may grow in place. If the block moved and the data isn't
+    // aligned anymore, it's moved to the aligned position inside the block.
+    char*  raw    = raw_block(ptr);
+    size_t offset = (size_t)(ptr - raw);
+    char*  moved  = LK_REALLOC(raw, new_size + small_padding(aligned));
+    if (!moved) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOC failed");
+        return NULL;
+    }
+    // the pointer to the block goes right before the data, so the data has
+    // to be in place before it is written
+    char* new_ptr = aligned_address(aligned, moved);
+    if ((size_t)(new_ptr - moved) != offset) {
+        memmove(new_ptr, moved + offset, old_size < new_size ? old_size : new_size);
+    }
+    return align_block(aligned, moved);
+}
+
+#ifdef LK_HAVE_MMAP
+
+static bool is_huge(lk_aligned* aligned, size_t size) {
+    return aligned->huge_threshold != 0 && size >= aligned->huge_threshold;
+}
+
+static size_t map_length(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + page - 1) & ~(page - 1);
+}
+
+static void advise_huge(void* ptr, size_t length) {
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, length, MADV_HUGEPAGE);
+#else
+    (void)ptr;
+    (void)length;
+#endif // MADV_HUGEPAGE
+}
+
+static void* huge_alloc(size_t size) {
+    size_t length = map_length(size);
+    if (length < size || length > SIZE_MAX - LK_HUGE_PAGE_SIZE) {
+        report_error(LK_ERR_INVALID_ARG, "size too large");
+        return NULL;
+    }
+
+    // map a huge page more than needed, and unmap what's around the
+    // aligned part
+    char* map = mmap(NULL, length + LK_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        report_error(LK_ERR_ALLOC, "mmap failed");
+        return NULL;
+    }
+    uintptr_t addr = ((uintptr_t)map + LK_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(LK_HUGE_PAGE_SIZE - 1);
+    char*     ptr  = (char*)addr;
+    size_t    head = (size_t)(ptr - map);
+    if (head > 0) {
+        munmap(map, head);
+    }
+    if (LK_HUGE_PAGE_SIZE - head > 0) {
+        munmap(ptr + length, LK_HUGE_PAGE_SIZE - head);
+    }
+
+    advise_huge(ptr, length);
+    return ptr;
+}
+
+static void* huge_realloc(lk_aligned* aligned, void* ptr, size_t old_size, size_t new_size) {
+    size_t old_length = map_length(old_size);
+    size_t new_length = map_length(new_size);
+    if (new_length < new_size) {
+        report_error(LK_ERR_INVALID_ARG, "size too large");
+        return NULL;
+    }
+    if (old_length == new_length) {
+        return ptr;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    void* map = mremap(ptr, old_length, new_length, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        report_error(LK_ERR_ALLOC, "mremap failed");
+        return NULL;
+    }
+    if (((uintptr_t)map & (aligned->alignment - 1)) == 0) {
+        advise_huge(map, new_length);
+        return map;
+    }
+    // moved to a less aligned address, fall back to copying
+    ptr        = map;
+    old_length = new_length;
+#else
+    (void)aligned;
+#endif // MREMAP_MAYMOVE
+
+    void* new_ptr = huge_alloc(new_size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    munmap(ptr, old_length);
+    return new_ptr;
+}
+
+#endif // LK_HAVE_MMAP
+
+static void* aligned_alloc_fn(void* ctx, size_t size) {
+    lk_aligned* aligned = ctx;
+#ifdef LK_HAVE_MMAP
+    if (is_huge(aligned, size)) {
+        return huge_alloc(size);
+    }
+#endif // LK_HAVE_MMAP
+    return small_alloc(aligned, size);
+}
+
+static void* aligned_alloc_zeroed_fn(void* ctx, size_t size) {
+    lk_aligned* aligned = ctx;
+#ifdef LK_HAVE_MMAP
+    if (is_huge(aligned, size)) {
+        // fresh mappings are zeroed, and only take memory once touched
+        return huge_alloc(size);
+    }
+#endif // LK_HAVE_MMAP
+    void* ptr = small_alloc(aligned, size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+static void aligned_free_fn(void* ctx, void* ptr, size_t size) {
+    lk_aligned* aligned = ctx;
+    if (!ptr) {
+        return;
+    }
+#ifdef LK_HAVE_MMAP
+    if (is_huge(aligned, size)) {
+        munmap(ptr, map_length(size));
+        return;
+    }
+#else
+    (void)aligned;
+    (void)size;
+#endif // LK_HAVE_MMAP
+    LK_FREE(raw_block(ptr));
+}
+
+static void* aligned_realloc_fn(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    lk_aligned* aligned = ctx;
+    if (!ptr) {
+        return aligned_alloc_fn(ctx, new_size);
+    }
+
+#ifdef LK_HAVE_MMAP
+    bool old_huge = is_huge(aligned, old_size);
+    bool new_huge = is_huge(aligned, new_size);
+    if (old_huge && new_huge) {
+        return huge_realloc(aligned, ptr, old_size, new_size);
+    }
+    if (old_huge || new_huge) {
+        // crossing the threshold moves the block
+        void* new_ptr = aligned_alloc_fn(ctx, new_size);
+        if (!new_ptr) {
+            return NULL;
+        }
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        aligned_free_fn(ctx, ptr, old_size);
+        return new_ptr;
+    }
+#endif // LK_HAVE_MMAP
+
+    return small_realloc(aligned, ptr, old_size, new_size);
+}
+
+bool lk_aligned_init(lk_aligned* aligned, size_t alignment, size_t huge_threshold) {
+    if (!aligned) {
+        report_error(LK_ERR_NULL, "aligned cannot be NULL");
+        return false;
+    }
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > LK_HUGE_PAGE_SIZE) {
+        report_error(LK_ERR_INVALID_ARG, "alignment has to be a power of two up to LK_HUGE_PAGE_SIZE");
+        return false;
+    }
+
+    aligned->alignment              = alignment;
+    aligned->huge_threshold         = huge_threshold;
+    aligned->allocator.alloc        = aligned_alloc_fn;
+    aligned->allocator.realloc      = aligned_realloc_fn;
+    aligned->allocator.free         = aligned_free_fn;
+    aligned->allocator.ctx          = aligned;
+    aligned->allocator.alloc_zeroed = aligned_alloc_zeroed_fn;
+
+    return true;
+}
+
+lk_allocator* lk_aligned_allocator(lk_aligned* aligned) {
+    if (!aligned) {
+        report_error(LK_ERR_NULL, "aligned cannot be NULL");
+        return NULL;
+    }
+
+    return &aligned->allocator;
+}
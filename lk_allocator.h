@@ -0,0 +1,121 @@
+#ifndef LK_ALLOCATOR_H
+#define LK_ALLOCATOR_H
+
+/*
+ * lk_allocator.h
+ *
+ * Defines the lk_allocator interface, which can be attached to an lk_array
+ * on creation (see lk_new_array_with_allocator), as well as three
+ * allocators implementing it:
+ * - lk_arena, a bump allocator which frees everything at once,
+ * - lk_pool, a size-class pool which recycles small blocks, such as
+ *   lk_array headers, and
+ * - lk_aligned, which aligns blocks and can map large ones directly,
+ *   backed by huge pages.
+ *
+ * All of them get their memory from LK_MALLOC and return it with LK_FREE,
+ * except for the large blocks of lk_aligned.
+ */
+
+#include "userdef_memory.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Allocator interface. All functions get passed ctx as first argument.
+/// realloc and free are passed the size the block was allocated
+/// (or last reallocated) with.
+/// realloc with ptr == NULL has to behave like alloc.
+/// alloc_zeroed is optional and may be NULL. If set, it returns zeroed
+/// blocks, ideally without writing to them (e.g. fresh pages from the OS);
+/// otherwise blocks from alloc are zeroed with memset.
+typedef struct {
+    void* (*alloc)(void* ctx, size_t size);
+    void* (*realloc)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+    void (*free)(void* ctx, void* ptr, size_t size);
+    void* ctx;
+    void* (*alloc_zeroed)(void* ctx, size_t size);
+} lk_allocator;
+
+typedef struct lk_arena_chunk lk_arena_chunk;
+
+/// Bump allocator. Allocations are carved out of big chunks, and
+/// individual frees do nothing (except for the most recent allocation).
+/// All memory is given back at once by lk_arena_reset or lk_arena_destroy.
+typedef struct {
+    lk_arena_chunk* head;
+    size_t          chunk_size;
+    void*           last;
+    lk_allocator    allocator;
+} lk_arena;
+
+/// Initializes arena to allocate chunks of chunk_size bytes.
+/// Does not allocate. Larger allocations get a chunk of their own.
+bool lk_arena_init(lk_arena* arena, size_t chunk_size);
+
+/// Returns the lk_allocator allocating from arena.
+/// Valid as long as arena is.
+lk_allocator* lk_arena_allocator(lk_arena* arena);
+
+/// Frees everything allocated from arena, but keeps one chunk around
+/// for further allocations. All arrays using this arena are invalid
+/// after this and must not be freed with lk_free_array.
+void lk_arena_reset(lk_arena* arena);
+
+/// Frees everything allocated from arena, including all chunks.
+void lk_arena_destroy(lk_arena* arena);
+
+
+/// Number of size classes in an lk_pool. The classes are
+/// 16, 32, 64, ... bytes, up to LK_POOL_MAX_SIZE.
+#define LK_POOL_CLASSES 8
+#define LK_POOL_MAX_SIZE ((size_t)16 << (LK_POOL_CLASSES - 1))
+
+/// Size-class pool. Blocks up to LK_POOL_MAX_SIZE bytes are rounded
+/// up to the next size class and recycled through a free list per class,
+/// so allocating and freeing lk_array headers or small buffers over and
+/// over doesn't hit LK_MALLOC. Larger blocks go to LK_MALLOC directly.
+typedef struct {
+    void*        free_lists[LK_POOL_CLASSES];
+    lk_arena     slabs;
+    lk_allocator allocator;
+} lk_pool;
+
+/// Initializes pool, which will carve blocks out of slabs of slab_size bytes.
+bool lk_pool_init(lk_pool* pool, size_t slab_size);
+
+/// Returns the lk_allocator allocating from pool.
+/// Valid as long as pool is.
+lk_allocator* lk_pool_allocator(lk_pool* pool);
+
+/// Frees all slabs of pool. Blocks larger than LK_POOL_MAX_SIZE must have
+/// been freed before this.
+void lk_pool_destroy(lk_pool* pool);
+
+
+/// Size of the huge pages lk_aligned aligns large blocks to.
+#define LK_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+/// Allocator for blocks aligned to a power of two, such as 64 bytes for
+/// cache lines and AVX-512 loads. Reallocating keeps the alignment.
+/// Blocks of at least huge_threshold bytes are mapped with mmap instead,
+/// aligned to LK_HUGE_PAGE_SIZE and marked with MADV_HUGEPAGE, so they can
+/// be backed by transparent huge pages. They grow with mremap, which moves
+/// pages instead of copying them. Large blocks are POSIX only, elsewhere
+/// huge_threshold is ignored.
+typedef struct {
+    size_t       alignment;
+    size_t       huge_threshold;
+    lk_allocator allocator;
+} lk_aligned;
+
+/// Initializes aligned to align blocks to alignment, which has to be a
+/// power of two no larger than LK_HUGE_PAGE_SIZE. If huge_threshold is 0,
+/// no blocks are mapped directly.
+bool lk_aligned_init(lk_aligned* aligned, size_t alignment, size_t huge_threshold);
+
+/// Returns the lk_allocator allocating from aligned.
+/// Valid as long as aligned is.
+lk_allocator* lk_aligned_allocator(lk_aligned* aligned);
+
+#endif // LK_ALLOCATOR_H
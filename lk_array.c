@@ -3,23 +3,70 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <stddef.h>
 
-static callback_ptr error_callback = NULL;
-
-// FIXME: This is very slow and ugly.
-#define report_error(str)              \
-    do {                               \
-        if (error_callback) {          \
-            char buf[512];             \
-            strcpy(buf, __FUNCTION__); \
-            strcat(buf, ": ");         \
-            strcat(buf, str);          \
-            error_callback(buf);       \
-        }                              \
+// the checked accessors are always compiled in
+#undef lk_at_raw
+#undef lk_get_raw
+#undef lk_set
+
+static _Atomic(callback_ptr) error_callback = NULL;
+
+static _Thread_local lk_error last_error = LK_OK;
+
+// Only builds the message if a callback is installed.
+static void call_error_callback(const char* func, const char* str) {
+    callback_ptr fn = atomic_load_explicit(&error_callback, memory_order_acquire);
+    if (fn) {
+        char buf[512];
+        snprintf(buf, sizeof(buf), "%s: %s", func, str);
+        fn(buf);
+    }
+}
+
+void lk_report_error_internal(lk_error code, const char* func, const char* str) {
+    last_error = code;
+    call_error_callback(func, str);
+}
+
+// The error code is set with a single store, the callback is only
+// loaded (and the message formatted) out of line.
+#define report_error(code, str)                 \
+    do {                                        \
+        last_error = code;                      \
+        call_error_callback(__FUNCTION__, str); \
     } while (0)
 
+lk_error lk_last_error(void) {
+    return last_error;
+}
+
+void lk_clear_error(void) {
+    last_error = LK_OK;
+}
+
+const char* lk_error_string(lk_error code) {
+    switch (code) {
+    case LK_OK:
+        return "no error";
+    case LK_ERR_NULL:
+        return "unexpected NULL pointer";
+    case LK_ERR_OUT_OF_BOUNDS:
+        return "index out of bounds";
+    case LK_ERR_INVALID_ARG:
+        return "invalid argument";
+    case LK_ERR_ALLOC:
+        return "allocation failed";
+    case LK_ERR_EMPTY:
+        return "array is empty";
+    }
+    return "unknown error";
+}
+
 void lk_setup_error_callback(callback_ptr fn) {
-    error_callback = fn;
+    atomic_store_explicit(&error_callback, fn, memory_order_release);
 }
 
 static void stderr_handler(const char* msg) {
@@ -28,124 +75,863 @@ static void stderr_handler(const char* msg) {
 }
 
 void lk_setup_error_callback_stderr() {
-    error_callback = stderr_handler;
+    lk_setup_error_callback(stderr_handler);
 }
 
-lk_array* lk_new_array(size_t size, size_t memb_size) {
+#ifdef LK_STATS
+// Process-wide counters, see lk_global_stats.
+static struct {
+    atomic_size_t reallocs;
+    atomic_size_t bytes_moved;
+    atomic_size_t peak_capacity;
+    atomic_size_t bounds_failures;
+    atomic_size_t allocator_calls;
+} global_stats;
+
+static _Atomic(lk_realloc_hook) realloc_hook = NULL;
+
+// Adds n to the counter field of arr (if not NULL) and the global one.
+#define stat_add(arr, field, n)                                                     \
+    do {                                                                            \
+        lk_array* stat_arr_ = (arr);                                                \
+        if (stat_arr_) {                                                            \
+            stat_arr_->stats.field += (n);                                          \
+        }                                                                           \
+        atomic_fetch_add_explicit(&global_stats.field, (n), memory_order_relaxed); \
+    } while (0)
+#else
+#define stat_add(arr, field, n) ((void)0)
+#endif // LK_STATS
+
+bool lk_array_stats(lk_array* arr, lk_stats* out) {
+    if (!arr || !out) {
+        report_error(LK_ERR_NULL, "arr and out cannot be NULL");
+        return false;
+    }
+
+#ifdef LK_STATS
+    *out                 = arr->stats;
+    out->wasted_capacity = (arr->capacity - arr->size) * arr->memb_size;
+    return true;
+#else
+    memset(out, 0, sizeof(lk_stats));
+    report_error(LK_ERR_INVALID_ARG, "compiled without LK_STATS");
+    return false;
+#endif // LK_STATS
+}
+
+bool lk_global_stats(lk_stats* out) {
+    if (!out) {
+        report_error(LK_ERR_NULL, "out cannot be NULL");
+        return false;
+    }
+
+    memset(out, 0, sizeof(lk_stats));
+#ifdef LK_STATS
+    out->reallocs        = atomic_load_explicit(&global_stats.reallocs, memory_order_relaxed);
+    out->bytes_moved     = atomic_load_explicit(&global_stats.bytes_moved, memory_order_relaxed);
+    out->peak_capacity   = atomic_load_explicit(&global_stats.peak_capacity, memory_order_relaxed);
+    out->bounds_failures = atomic_load_explicit(&global_stats.bounds_failures, memory_order_relaxed);
+    out->allocator_calls = atomic_load_explicit(&global_stats.allocator_calls, memory_order_relaxed);
+    return true;
+#else
+    report_error(LK_ERR_INVALID_ARG, "compiled without LK_STATS");
+    return false;
+#endif // LK_STATS
+}
+
+void lk_set_realloc_hook(lk_realloc_hook fn) {
+#ifdef LK_STATS
+    atomic_store_explicit(&realloc_hook, fn, memory_order_release);
+#else
+    (void)fn;
+#endif // LK_STATS
+}
+
+// The following go through allocator, or the LK_* macros if it's NULL.
+
+static void* mem_alloc(lk_allocator* allocator, size_t size) {
+    if (!allocator) {
+        return LK_MALLOC(size);
+    }
+    return allocator->alloc(allocator->ctx, size);
+}
+
+static void* mem_calloc(lk_allocator* allocator, size_t nmemb, size_t size) {
+    if (!allocator) {
+        return LK_CALLOC(nmemb, size);
+    }
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+        return NULL;
+    }
+    if (allocator->alloc_zeroed) {
+        return allocator->alloc_zeroed(allocator->ctx, nmemb * size);
+    }
+    void* ptr = allocator->alloc(allocator->ctx, nmemb * size);
+    if (ptr) {
+        memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+static void* mem_reallocarray(lk_allocator* allocator, void* ptr, size_t old_size, size_t nmemb, size_t size) {
+    if (!allocator) {
+        return LK_REALLOCARRAY(ptr, nmemb, size);
+    }
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+        return NULL;
+    }
+    return allocator->realloc(allocator->ctx, ptr, old_size, nmemb * size);
+}
+
+static void mem_free(lk_allocator* allocator, void* ptr, size_t size) {
+    if (!allocator) {
+        LK_FREE(ptr);
+        return;
+    }
+    allocator->free(allocator->ctx, ptr, size);
+}
+
+// The inline buffer of an array created by lk_new_array_inline starts
+// at this offset from the lk_array.
+#define INLINE_OFFSET \
+    ((sizeof(lk_array) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+static bool is_inline(lk_array* arr) {
+    return arr->inline_bytes != 0 && arr->data == (char*)arr + INLINE_OFFSET;
+}
+
+static size_t header_size(lk_array* arr) {
+    return arr->inline_bytes != 0 ? INLINE_OFFSET + arr->inline_bytes : sizeof(lk_array);
+}
+
+// Reference counted buffer shared by arrays, see lk_array_share.
+struct lk_shared {
+    atomic_size_t refs;
+    void*         data;
+    size_t        bytes;
+};
+
+// Drops the reference of arr to its shared buffer, freeing the buffer
+// if it was the last one.
+static void drop_shared(lk_array* arr) {
+    lk_shared* shared = arr->shared;
+    arr->shared       = NULL;
+    if (atomic_fetch_sub_explicit(&shared->refs, 1, memory_order_acq_rel) == 1) {
+        mem_free(arr->allocator, shared->data, shared->bytes);
+        mem_free(arr->allocator, shared, sizeof(lk_shared));
+    }
+}
+
+// If arr holds the only reference to its shared buffer, it takes
+// ownership of the buffer again.
+static void claim_shared(lk_array* arr) {
+    lk_shared* shared = arr->shared;
+    if (atomic_load_explicit(&shared->refs, memory_order_acquire) == 1) {
+        arr->shared = NULL;
+        mem_free(arr->allocator, shared, sizeof(lk_shared));
+    }
+}
+
+// Reallocates arr->data to hold nmemb elements of memb_size,
+// moving the data out of the inline buffer or a shared buffer if needed.
+static void* realloc_data(lk_array* arr, size_t nmemb, size_t memb_size) {
+    stat_add(arr, allocator_calls, 1);
+    stat_add(arr, reallocs, 1);
+    stat_add(arr, bytes_moved, arr->size * arr->memb_size);
+
+    if (arr->shared) {
+        claim_shared(arr);
+    }
+
+    if (!is_inline(arr) && !arr->shared) {
+        return mem_reallocarray(arr->allocator, arr->data, arr->capacity * arr->memb_size, nmemb, memb_size);
+    }
+
+    // the old buffer may not be touched, copy out of it
+    void* new_data = mem_reallocarray(arr->allocator, NULL, 0, nmemb, memb_size);
+    if (new_data) {
+        size_t used = arr->size * arr->memb_size;
+        memcpy(new_data, arr->data, used < nmemb * memb_size ? used : nmemb * memb_size);
+        if (arr->shared) {
+            drop_shared(arr);
+        }
+    }
+    return new_data;
+}
+
+// Points arr->data at the inline buffer if there is one, NULL otherwise.
+static void reset_data(lk_array* arr) {
+    if (arr->inline_bytes != 0) {
+        arr->data     = (char*)arr + INLINE_OFFSET;
+        arr->capacity = arr->inline_bytes / arr->memb_size;
+    } else {
+        arr->data     = NULL;
+        arr->capacity = 0;
+    }
+}
+
+// Sets the data and capacity of arr after a reallocation.
+static void set_data(lk_array* arr, void* data, size_t capacity) {
+#ifdef LK_STATS
+    size_t old_capacity = arr->capacity;
+    size_t bytes        = capacity * arr->memb_size;
+    if (bytes > arr->stats.peak_capacity) {
+        arr->stats.peak_capacity = bytes;
+    }
+    size_t peak = atomic_load_explicit(&global_stats.peak_capacity, memory_order_relaxed);
+    while (bytes > peak
+        && !atomic_compare_exchange_weak_explicit(&global_stats.peak_capacity, &peak, bytes,
+            memory_order_relaxed, memory_order_relaxed)) {
+    }
+#endif // LK_STATS
+
+    arr->data     = data;
+    arr->capacity = capacity;
+
+#ifdef LK_STATS
+    lk_realloc_hook hook = atomic_load_explicit(&realloc_hook, memory_order_acquire);
+    if (hook) {
+        hook(arr, old_capacity, capacity);
+    }
+#endif // LK_STATS
+}
+
+// Frees arr->data, unless it's the inline buffer or still shared with
+// other arrays, and resets it.
+static void free_data(lk_array* arr) {
+    if (arr->shared) {
+        drop_shared(arr);
+    } else if (!is_inline(arr)) {
+        stat_add(arr, allocator_calls, 1);
+        mem_free(arr->allocator, arr->data, arr->capacity * arr->memb_size);
+    }
+    reset_data(arr);
+}
+
+// Makes sure arr is the only owner of its data, copying it if needed.
+static bool unshare(lk_array* arr) {
+    if (!arr->shared) {
+        return true;
+    }
+
+    claim_shared(arr);
+    if (!arr->shared) {
+        return true;
+    }
+
+    void* new_data = realloc_data(arr, arr->capacity, arr->memb_size);
+    if (!new_data) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+
+    set_data(arr, new_data, arr->capacity);
+
+    return true;
+}
+
+// Allocates a new array of size elements, which are zeroed if zeroed is true.
+static lk_array* new_array(size_t size, size_t memb_size, size_t inline_bytes, lk_allocator* allocator, bool zeroed) {
     if (memb_size == 0) {
-        report_error("memb_size may never be 0");
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    if (inline_bytes > SIZE_MAX - INLINE_OFFSET) {
+        report_error(LK_ERR_INVALID_ARG, "inline_bytes too large");
         return NULL;
     }
 
-    lk_array* arr = lk_new(lk_array);
+    size_t    header = inline_bytes != 0 ? INLINE_OFFSET + inline_bytes : sizeof(lk_array);
+    lk_array* arr    = mem_alloc(allocator, header);
     if (!arr) {
-        report_error("LK_MALLOC failed");
+        report_error(LK_ERR_ALLOC, "allocation of lk_array failed");
         return NULL;
     }
 
-    if (size == 0) {
-        arr->data      = NULL;
-        arr->memb_size = memb_size;
-        arr->size      = 0;
-        arr->capacity  = 0;
+#ifdef LK_STATS
+    memset(&arr->stats, 0, sizeof(lk_stats));
+#endif // LK_STATS
+    stat_add(arr, allocator_calls, 1);
+    arr->allocator     = allocator;
+    arr->shared        = NULL;
+    arr->inline_bytes  = inline_bytes;
+    arr->growth_factor = LK_DEFAULT_GROWTH_FACTOR;
+    arr->min_capacity  = LK_DEFAULT_MIN_CAPACITY;
+    arr->memb_size     = memb_size;
+    arr->size          = 0;
+    reset_data(arr);
+
+    if (size <= arr->capacity) {
+        if (arr->data && zeroed) {
+            memset(arr->data, 0, size * memb_size);
+        }
+        arr->size = size;
     } else {
-        arr->data = LK_CALLOC(size, memb_size);
+        stat_add(arr, allocator_calls, 1);
+        // calloc gets fresh zeroed pages from the OS without touching them
+        arr->data = zeroed ? mem_calloc(allocator, size, memb_size)
+                           : mem_reallocarray(allocator, NULL, 0, size, memb_size);
         if (!arr->data) {
-            LK_FREE(arr);
-            report_error("LK_CALLOC failed");
+            mem_free(allocator, arr, header);
+            report_error(LK_ERR_ALLOC, "allocation of data failed");
             return NULL;
         }
-        arr->memb_size = memb_size;
-        arr->size      = size;
-        arr->capacity  = size;
+        arr->size     = size;
+        arr->capacity = size;
+#ifdef LK_STATS
+        arr->stats.peak_capacity = size * memb_size;
+#endif // LK_STATS
     }
 
     return arr;
 }
 
+lk_array* lk_new_array(size_t size, size_t memb_size) {
+    return new_array(size, memb_size, 0, NULL, true);
+}
+
+lk_array* lk_new_array_uninit(size_t size, size_t memb_size) {
+    return new_array(size, memb_size, 0, NULL, false);
+}
+
+lk_array* lk_new_array_with_allocator(size_t size, size_t memb_size, lk_allocator* allocator) {
+    return new_array(size, memb_size, 0, allocator, true);
+}
+
+lk_array* lk_new_array_inline(size_t size, size_t memb_size, size_t inline_bytes, lk_allocator* allocator) {
+    return new_array(size, memb_size, inline_bytes, allocator, true);
+}
+
 void lk_free_array_internal(lk_array* ptr) {
     if (!ptr) {
         // freeing a NULL ptr is okay, no error
         return;
     }
-    free(ptr->data);
-    free(ptr);
+    free_data(ptr);
+    stat_add(NULL, allocator_calls, 1);
+    mem_free(ptr->allocator, ptr, header_size(ptr));
 }
 
 bool lk_array_deep_copy(lk_array* dest, lk_array* src) {
     if (!src) {
-        report_error("source cannot be NULL");
+        report_error(LK_ERR_NULL, "source cannot be NULL");
         return false;
     }
     if (!dest) {
-        report_error("dest cannot be NULL");
+        report_error(LK_ERR_NULL, "dest cannot be NULL");
         return false;
     }
 
+    // reallocating to 0 elements would free dest's data and return NULL
+    if (src->size == 0) {
+        return lk_discard_internal(dest, src->memb_size);
+    }
 
     // reallocarray to save us free'ing and calloc'ing here if
     // the arrays are the same size or src->size < dest->size
-    void* new_data = LK_REALLOCARRAY(dest->data, src->size, src->memb_size);
+    void* new_data = realloc_data(dest, src->size, src->memb_size);
     if (!new_data) {
-        report_error("LK_REALLOCARRAY failed");
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
         return false;
     }
 
-    // realloc was successful, set ptr
-    dest->data = new_data;
     // copy size
     dest->size = src->size;
-    // capacity is size for dest, since src might have different capacity
-    dest->capacity = dest->size;
     // copy member size
     dest->memb_size = src->memb_size;
+    // realloc was successful, set ptr
+    // capacity is size for dest, since src might have different capacity
+    set_data(dest, new_data, dest->size);
 
     if (!src->data) {
-        report_error("src->data is NULL");
+        report_error(LK_ERR_NULL, "src->data is NULL");
         return false;
     }
     if (!dest->data) {
-        report_error("dest->data is NULL");
+        report_error(LK_ERR_NULL, "dest->data is NULL");
         return false;
     }
 
     // deep copy memory from src to dest
-    memcpy(dest->data, src->data, dest->size);
+    stat_add(dest, bytes_moved, dest->size * dest->memb_size);
+    memcpy(dest->data, src->data, dest->size * dest->memb_size);
+
+    return true;
+}
+
+// Moves the data of an inline array to the heap, so it can be handed out.
+static bool spill_inline(lk_array* arr) {
+    if (!is_inline(arr)) {
+        return true;
+    }
+
+    void* new_data = realloc_data(arr, arr->capacity, arr->memb_size);
+    if (!new_data) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+
+    set_data(arr, new_data, arr->capacity);
+
+    return true;
+}
+
+bool lk_array_swap(lk_array* a, lk_array* b) {
+    if (!a || !b) {
+        report_error(LK_ERR_NULL, "arrays cannot be NULL");
+        return false;
+    }
+
+    if (a->allocator != b->allocator) {
+        report_error(LK_ERR_INVALID_ARG, "arrays have different allocators");
+        return false;
+    }
+
+    if (!spill_inline(a) || !spill_inline(b)) {
+        report_error(LK_ERR_ALLOC, "spill_inline failed");
+        return false;
+    }
+
+    lk_array tmp = *a;
+
+    a->data          = b->data;
+    a->shared        = b->shared;
+    a->memb_size     = b->memb_size;
+    a->size          = b->size;
+    a->capacity      = b->capacity;
+    a->growth_factor = b->growth_factor;
+    a->min_capacity  = b->min_capacity;
+
+    b->data          = tmp.data;
+    b->shared        = tmp.shared;
+    b->memb_size     = tmp.memb_size;
+    b->size          = tmp.size;
+    b->capacity      = tmp.capacity;
+    b->growth_factor = tmp.growth_factor;
+    b->min_capacity  = tmp.min_capacity;
+
+    return true;
+}
+
+bool lk_array_move(lk_array* dest, lk_array* src) {
+    if (!dest || !src) {
+        report_error(LK_ERR_NULL, "arrays cannot be NULL");
+        return false;
+    }
+
+    if (dest == src) {
+        return true;
+    }
+
+    if (dest->allocator != src->allocator || is_inline(src)) {
+        // the buffer can't be handed over, copy instead
+        if (!lk_array_deep_copy(dest, src)) {
+            report_error(lk_last_error(), "lk_array_deep_copy failed");
+            return false;
+        }
+        free_data(src);
+    } else {
+        free_data(dest);
+        dest->data      = src->data;
+        dest->shared    = src->shared;
+        dest->memb_size = src->memb_size;
+        dest->size      = src->size;
+        dest->capacity  = src->capacity;
+        src->data       = NULL;
+        src->shared     = NULL;
+        src->capacity   = 0;
+    }
+
+    src->size = 0;
+    reset_data(src);
+
+    return true;
+}
+
+lk_array* lk_array_adopt(void* data, size_t size, size_t capacity, size_t memb_size) {
+    if (!data && capacity != 0) {
+        report_error(LK_ERR_NULL, "data cannot be NULL");
+        return NULL;
+    }
+
+    if (size > capacity) {
+        report_error(LK_ERR_INVALID_ARG, "size cannot be larger than capacity");
+        return NULL;
+    }
+
+    lk_array* arr = new_array(0, memb_size, 0, NULL, false);
+    if (!arr) {
+        report_error(lk_last_error(), "new_array failed");
+        return NULL;
+    }
+
+    arr->data     = data;
+    arr->size     = size;
+    arr->capacity = capacity;
+
+    return arr;
+}
+
+void* lk_array_release(lk_array* arr, size_t* size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return NULL;
+    }
+
+    if (!spill_inline(arr) || !unshare(arr)) {
+        report_error(LK_ERR_ALLOC, "cannot take ownership of data");
+        return NULL;
+    }
+
+    void* data = arr->data;
+    if (size) {
+        *size = arr->size;
+    }
+
+    arr->size = 0;
+    reset_data(arr);
+
+    return data;
+}
+
+bool lk_array_share(lk_array* dest, lk_array* src) {
+    if (!dest || !src) {
+        report_error(LK_ERR_NULL, "arrays cannot be NULL");
+        return false;
+    }
+
+    if (dest->allocator != src->allocator) {
+        report_error(LK_ERR_INVALID_ARG, "arrays have different allocators");
+        return false;
+    }
+
+    if (dest == src || (dest->shared && dest->shared == src->shared)) {
+        dest->size = src->size;
+        return true;
+    }
+
+    if (!spill_inline(src)) {
+        report_error(LK_ERR_ALLOC, "spill_inline failed");
+        return false;
+    }
+
+    if (src->data && !src->shared) {
+        lk_shared* shared = mem_alloc(src->allocator, sizeof(lk_shared));
+        if (!shared) {
+            report_error(LK_ERR_ALLOC, "allocation of lk_shared failed");
+            return false;
+        }
+        atomic_init(&shared->refs, 1);
+        shared->data  = src->data;
+        shared->bytes = src->capacity * src->memb_size;
+        src->shared   = shared;
+    }
+
+    free_data(dest);
+    dest->memb_size = src->memb_size;
+    dest->size      = src->size;
+    if (src->shared) {
+        atomic_fetch_add_explicit(&src->shared->refs, 1, memory_order_relaxed);
+        dest->data     = src->data;
+        dest->shared   = src->shared;
+        dest->capacity = src->capacity;
+    }
+
+    return true;
+}
+
+bool lk_array_unshare(lk_array* arr) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    return unshare(arr);
+}
+
+bool lk_array_is_shared(lk_array* arr) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    return arr->shared && atomic_load_explicit(&arr->shared->refs, memory_order_acquire) > 1;
+}
+
+lk_array_view lk_array_slice(lk_array* arr, size_t index, size_t count) {
+    lk_array_view view = { NULL, 0, 0 };
+
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return view;
+    }
+
+    if (index > arr->size || count > arr->size - index) {
+        stat_add(arr, bounds_failures, 1);
+        report_error(LK_ERR_OUT_OF_BOUNDS, "range out of bounds");
+        return view;
+    }
+
+    view.data      = count != 0 ? (char*)arr->data + index * arr->memb_size : NULL;
+    view.memb_size = arr->memb_size;
+    view.size      = count;
+
+    return view;
+}
+
+void* lk_view_at_raw(lk_array_view* view, size_t index) {
+    if (!view) {
+        report_error(LK_ERR_NULL, "view cannot be NULL");
+        return NULL;
+    }
+
+    if (index >= view->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return NULL;
+    }
+
+    return (char*)view->data + index * view->memb_size;
+}
+
+bool lk_grow_internal(lk_array* arr, size_t needed) {
+    if (needed <= arr->capacity) {
+        return true;
+    }
+
+    size_t max_capacity = SIZE_MAX / arr->memb_size;
+    if (needed > max_capacity) {
+        report_error(LK_ERR_INVALID_ARG, "needed too large");
+        return false;
+    }
+
+    // the product may not fit into a size_t, casting it would be undefined
+    double grown        = (double)arr->capacity * arr->growth_factor;
+    size_t new_capacity = grown < (double)max_capacity ? (size_t)grown : max_capacity;
+    if (new_capacity <= arr->capacity) {
+        // small capacities may not grow with small factors, ensure progress
+        new_capacity = arr->capacity + 1;
+    }
+    if (new_capacity < arr->min_capacity) {
+        new_capacity = arr->min_capacity;
+    }
+    if (new_capacity < needed) {
+        new_capacity = needed;
+    }
+    if (new_capacity > max_capacity) {
+        // (double)max_capacity may have been rounded up
+        new_capacity = max_capacity;
+    }
+
+    void* new_data = realloc_data(arr, new_capacity, arr->memb_size);
+    if (!new_data) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+
+    set_data(arr, new_data, new_capacity);
+
+    return true;
+}
+
+bool lk_discard_internal(lk_array* arr, size_t memb_size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return false;
+    }
+
+    free_data(arr);
+    arr->size      = 0;
+    arr->memb_size = memb_size;
+    // the inline capacity depends on memb_size
+    reset_data(arr);
+
+    return true;
+}
+
+bool lk_set_growth_policy(lk_array* arr, double growth_factor, size_t min_capacity) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (!(growth_factor > 1.0)) {
+        report_error(LK_ERR_INVALID_ARG, "growth_factor must be greater than 1.0");
+        return false;
+    }
+
+    arr->growth_factor = growth_factor;
+    arr->min_capacity  = min_capacity;
 
     return true;
 }
 
 bool lk_push_back(lk_array* arr, void* buf) {
     if (!arr) {
-        report_error("arr cannot be NULL");
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
         return false;
     }
 
     if (!buf) {
-        report_error("buf cannot be NULL");
+        report_error(LK_ERR_NULL, "buf cannot be NULL");
         return false;
     }
 
-    bool rc = lk_resize(arr, arr->size + 1);
+    // growing moves a shared buffer anyway, so only unshare afterwards
+    bool rc = lk_grow_internal(arr, arr->size + 1) && unshare(arr);
     if (!rc) {
-        report_error("lk_resize failed");
+        report_error(LK_ERR_ALLOC, "lk_grow_internal failed");
         return false;
     }
 
-    size_t index = arr->memb_size * (arr->size - 1);
-    memcpy(arr->data + index, buf, sizeof(arr->memb_size));
+    size_t index = arr->memb_size * arr->size;
+    stat_add(arr, bytes_moved, arr->memb_size);
+    memcpy(arr->data + index, buf, arr->memb_size);
+    ++arr->size;
+
+    return true;
+}
+
+bool lk_append_n(lk_array* arr, void* buf, size_t count) {
+    return lk_insert_range(arr, arr ? arr->size : 0, buf, count);
+}
+
+bool lk_insert_range(lk_array* arr, size_t index, void* buf, size_t count) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (count == 0) {
+        return true;
+    }
+
+    if (!buf) {
+        report_error(LK_ERR_NULL, "buf cannot be NULL");
+        return false;
+    }
+
+    if (index > arr->size) {
+        stat_add(arr, bounds_failures, 1);
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    if (count > SIZE_MAX - arr->size) {
+        report_error(LK_ERR_INVALID_ARG, "count too large");
+        return false;
+    }
+
+    bool rc = lk_grow_internal(arr, arr->size + count) && unshare(arr);
+    if (!rc) {
+        report_error(LK_ERR_ALLOC, "lk_grow_internal failed");
+        return false;
+    }
+
+    char* at = (char*)arr->data + index * arr->memb_size;
+    stat_add(arr, bytes_moved, (arr->size - index + count) * arr->memb_size);
+    if (index < arr->size) {
+        memmove(at + count * arr->memb_size, at, (arr->size - index) * arr->memb_size);
+    }
+    memcpy(at, buf, count * arr->memb_size);
+    arr->size += count;
+
+    return true;
+}
+
+bool lk_erase_range(lk_array* arr, size_t index, size_t count) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (index > arr->size || count > arr->size - index) {
+        stat_add(arr, bounds_failures, 1);
+        report_error(LK_ERR_OUT_OF_BOUNDS, "range out of bounds");
+        return false;
+    }
+
+    if (count == 0) {
+        return true;
+    }
+
+    if (!unshare(arr)) {
+        report_error(LK_ERR_ALLOC, "unshare failed");
+        return false;
+    }
+
+    char*  at   = (char*)arr->data + index * arr->memb_size;
+    size_t tail = arr->size - index - count;
+    stat_add(arr, bytes_moved, tail * arr->memb_size);
+    if (tail > 0) {
+        memmove(at, at + count * arr->memb_size, tail * arr->memb_size);
+    }
+    arr->size -= count;
+
+    return true;
+}
+
+bool lk_pop_back(lk_array* arr, void* out) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (arr->size == 0) {
+        report_error(LK_ERR_EMPTY, "arr is empty");
+        return false;
+    }
+
+    --arr->size;
+    if (out) {
+        stat_add(arr, bytes_moved, arr->memb_size);
+        memcpy(out, (char*)arr->data + arr->size * arr->memb_size, arr->memb_size);
+    }
+
+    return true;
+}
+
+bool lk_swap_remove(lk_array* arr, size_t index) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (index >= arr->size) {
+        stat_add(arr, bounds_failures, 1);
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    if (!unshare(arr)) {
+        report_error(LK_ERR_ALLOC, "unshare failed");
+        return false;
+    }
+
+    --arr->size;
+    if (index != arr->size) {
+        char* data = arr->data;
+        stat_add(arr, bytes_moved, arr->memb_size);
+        memcpy(data + index * arr->memb_size, data + arr->size * arr->memb_size, arr->memb_size);
+    }
 
     return true;
 }
 
 bool lk_reserve(lk_array* arr, size_t new_size) {
     if (!arr) {
-        report_error("arr cannot be NULL");
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
         return false;
     }
 
     if (new_size < arr->size) {
-        report_error("cannot reserve less than is already used by arr");
+        report_error(LK_ERR_INVALID_ARG, "cannot reserve less than is already used by arr");
         return false;
     }
 
@@ -155,64 +941,86 @@ bool lk_reserve(lk_array* arr, size_t new_size) {
         return true;
     }
 
-    void* new_data = LK_REALLOCARRAY(arr->data, new_size, arr->memb_size);
+    void* new_data = realloc_data(arr, new_size, arr->memb_size);
     if (!new_data) {
-        report_error("LK_REALLOCARRAY failed");
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
         return false;
     }
 
-    arr->data     = new_data;
-    arr->capacity = new_size;
+    set_data(arr, new_data, new_size);
 
     return true;
 }
 
-bool lk_resize(lk_array* arr, size_t new_size) {
+// Resizes arr to new_size elements. New elements are zeroed if zeroed is true.
+static bool resize(lk_array* arr, size_t new_size, bool zeroed) {
     if (!arr) {
-        report_error("arr cannot be NULL");
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
         return false;
     }
 
     if (new_size == 0) {
-        LK_FREE(arr->data);
-        arr->data     = NULL;
-        arr->size     = 0;
-        arr->capacity = 0;
+        free_data(arr);
+        arr->size = 0;
         return true;
     }
 
+    size_t old_size = arr->size;
     if (new_size <= arr->capacity) {
-        // already reserved, expand
-        arr->size = new_size;
-        return true;
-    }
+        // already reserved, expand. The new elements are about to be
+        // written, so they have to be ours.
+        if (new_size > old_size && !unshare(arr)) {
+            report_error(LK_ERR_ALLOC, "unshare failed");
+            return false;
+        }
+    } else {
+        void* new_data;
+        if (zeroed && !arr->data) {
+            // nothing to keep, so fresh zeroed pages from calloc will do
+            stat_add(arr, allocator_calls, 1);
+            new_data = mem_calloc(arr->allocator, new_size, arr->memb_size);
+            old_size = new_size;
+        } else {
+            new_data = realloc_data(arr, new_size, arr->memb_size);
+        }
+        if (!new_data) {
+            report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+            return false;
+        }
 
-    void* new_data = LK_REALLOCARRAY(arr->data, new_size, arr->memb_size);
-    if (!new_data) {
-        report_error("LK_REALLOCARRAY failed");
-        return false;
+        set_data(arr, new_data, new_size);
     }
 
-    arr->data     = new_data;
-    arr->size     = new_size;
-    arr->capacity = new_size;
+    if (zeroed && new_size > old_size) {
+        memset((char*)arr->data + old_size * arr->memb_size, 0, (new_size - old_size) * arr->memb_size);
+    }
+    arr->size = new_size;
 
     return true;
 }
 
+bool lk_resize(lk_array* arr, size_t new_size) {
+    return resize(arr, new_size, true);
+}
+
+bool lk_resize_uninit(lk_array* arr, size_t new_size) {
+    return resize(arr, new_size, false);
+}
+
 void* lk_at_raw(lk_array* arr, size_t index) {
     if (!arr) {
-        report_error("arr cannot be NULL");
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
         return NULL;
     }
 
     if (index >= arr->size) {
-        report_error("index out of bounds");
+        stat_add(arr, bounds_failures, 1);
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
         return NULL;
     }
 
     if (!arr->data) {
-        report_error("arr->data is NULL ?!");
+        report_error(LK_ERR_NULL, "arr->data is NULL ?!");
         return NULL;
     }
 
@@ -221,7 +1029,7 @@ void* lk_at_raw(lk_array* arr, size_t index) {
 
 void* lk_get_raw(lk_array* arr) {
     if (!arr) {
-        report_error("arr cannot be NULL");
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
         return NULL;
     }
 
@@ -231,16 +1039,24 @@ void* lk_get_raw(lk_array* arr) {
 bool lk_set(lk_array* arr, size_t index, void* value) {
     void* data = lk_get_raw(arr);
     if (!data) {
-        report_error("lk_get_raw failed");
+        report_error(LK_ERR_NULL, "lk_get_raw failed");
         return false;
     }
 
     if (index >= arr->size) {
-        report_error("index out of range");
+        stat_add(arr, bounds_failures, 1);
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of range");
+        return false;
+    }
+
+    if (!unshare(arr)) {
+        report_error(LK_ERR_ALLOC, "unshare failed");
         return false;
     }
 
+    data = arr->data;
     data += index * arr->memb_size;
+    stat_add(arr, bytes_moved, arr->memb_size);
     memcpy(data, value, arr->memb_size);
 
     return true;
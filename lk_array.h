@@ -10,6 +10,7 @@
  */
 
 #include "userdef_memory.h"
+#include "lk_allocator.h"
 /* From this point onwards only macros should be used for
  * memory allocation / deallocation / reallocation.
  * Namely these are
@@ -19,23 +20,94 @@
  * - LK_REALLOC,
  * - LK_REALLOCARRAY.
  * These may be overridden by defining them before this include.
+ * Arrays created with lk_new_array_with_allocator use the given
+ * lk_allocator instead.
  */
 
 #include <stdbool.h>
+#include <assert.h>
+#include <string.h>
 
 /// Macro to simplify malloc's
 #define lk_new(type) (type*)LK_MALLOC(sizeof(type))
 
 typedef void (*callback_ptr)(const char*);
 
+/// Error codes, see lk_last_error.
+typedef enum {
+    LK_OK = 0,
+    LK_ERR_NULL,          // a pointer argument (or arr->data) was NULL
+    LK_ERR_OUT_OF_BOUNDS, // index or range out of bounds
+    LK_ERR_INVALID_ARG,   // any other invalid argument
+    LK_ERR_ALLOC,         // an allocation failed
+    LK_ERR_EMPTY,         // operation requires a non-empty array
+} lk_error;
+
+/// Default factor by which capacity grows when lk_push_back runs out of space.
+/// May be overridden by defining it before this include.
+#ifndef LK_DEFAULT_GROWTH_FACTOR
+#define LK_DEFAULT_GROWTH_FACTOR 2.0
+#endif // LK_DEFAULT_GROWTH_FACTOR
+
+/// Default capacity of the first allocation made by growing an empty array.
+/// May be overridden by defining it before this include.
+#ifndef LK_DEFAULT_MIN_CAPACITY
+#define LK_DEFAULT_MIN_CAPACITY 4
+#endif // LK_DEFAULT_MIN_CAPACITY
+
+/// Instrumentation counters, see lk_array_stats.
+/// Only collected if LK_STATS is defined (for all translation units).
+/// All sizes are in bytes.
+typedef struct {
+    // number of reallocations of the data
+    size_t reallocs;
+    // bytes moved by reallocations (assuming they always move) and memcpy/memmove
+    size_t bytes_moved;
+    // largest capacity ever reached
+    size_t peak_capacity;
+    // capacity not used by elements right now (per array only)
+    size_t wasted_capacity;
+    // failed bounds checks
+    size_t bounds_failures;
+    // calls to the allocator (allocations, reallocations, frees)
+    size_t allocator_calls;
+} lk_stats;
+
+/// Reference counted buffer of arrays sharing data, see lk_array_share.
+typedef struct lk_shared lk_shared;
+
 /// Structure that holds all data concerning an array in this library.
 typedef struct {
     void*  data;
     size_t memb_size;
     size_t size;
     size_t capacity;
+    // NULL to use the LK_* allocation macros
+    lk_allocator* allocator;
+    // non-NULL if data may be shared with other arrays, see lk_array_share
+    lk_shared* shared;
+    // size of the inline buffer behind this struct, see lk_new_array_inline
+    size_t inline_bytes;
+    // growth policy, see lk_set_growth_policy
+    double growth_factor;
+    size_t min_capacity;
+#ifdef LK_STATS
+    lk_stats stats;
+#endif // LK_STATS
 } lk_array;
 
+/// Non-owning view of a range of elements, see lk_array_slice.
+/// Valid as long as the array it points into isn't reallocated or freed.
+typedef struct {
+    void*  data;
+    size_t memb_size;
+    size_t size;
+} lk_array_view;
+
+/// Hook called after every reallocation of an array's data,
+/// if LK_STATS is defined.
+typedef void (*lk_realloc_hook)(lk_array* arr, size_t old_capacity, size_t new_capacity);
+
 /// Macro to use for freeing lk_arrays. Ensures pointer gets sanitized in
 /// an attempt to ensure use-after-free.
 #define lk_free_array(ptr)           \
@@ -49,6 +121,23 @@ typedef struct {
 /// The returned pointer, if not NULL, has to be free'd using lk_free_array.
 lk_array* lk_new_array(size_t size, size_t member_size);
 
+/// Like lk_new_array, but the size elements are left uninitialized, for
+/// when they are overwritten right away anyway. Untouched pages of a large
+/// array don't take up memory.
+lk_array* lk_new_array_uninit(size_t size, size_t member_size);
+
+/// Like lk_new_array, but both the lk_array and its data are allocated
+/// from allocator, which has to outlive the array. If allocator is NULL,
+/// this is equivalent to lk_new_array.
+lk_array* lk_new_array_with_allocator(size_t size, size_t member_size, lk_allocator* allocator);
+
+/// Like lk_new_array_with_allocator, but the lk_array is allocated together
+/// with an inline buffer of inline_bytes bytes. As long as the elements fit
+/// into it, arr->data points into the inline buffer and no separate
+/// allocation is made for them. Growing past it moves the data to the heap.
+/// allocator may be NULL.
+lk_array* lk_new_array_inline(size_t size, size_t member_size, size_t inline_bytes, lk_allocator* allocator);
+
 /// Internal free() function for lk_arrays. Use lk_free_array instead.
 void lk_free_array_internal(lk_array* ptr);
 
@@ -56,12 +145,92 @@ void lk_free_array_internal(lk_array* ptr);
 /// Will fail if dest or src are NULL.
 bool lk_array_deep_copy(lk_array* dest, lk_array* src);
 
+/// Swaps the contents (data, sizes and growth policy) of a and b in O(1).
+/// Both have to use the same allocator. Inline buffers are not swapped:
+/// data held in one is moved to the heap first.
+bool lk_array_swap(lk_array* a, lk_array* b);
+
+/// Moves the contents of src into dest in O(1), freeing what dest held
+/// before. src is empty afterwards. Falls back to lk_array_deep_copy if the
+/// arrays use different allocators or src holds its data inline.
+bool lk_array_move(lk_array* dest, lk_array* src);
+
+/// Wraps data, holding size elements of memb_size with room for capacity
+/// elements, in a new lk_array without copying. data has to have been
+/// allocated with LK_MALLOC, LK_CALLOC or LK_REALLOC(ARRAY), and is owned
+/// by the array afterwards.
+/// The returned pointer may be NULL on error.
+lk_array* lk_array_adopt(void* data, size_t size, size_t capacity, size_t memb_size);
+
+/// Gives up ownership of the data of arr and returns it, storing the number
+/// of elements in size (if not NULL). arr is empty afterwards.
+/// The caller has to free the data with arr's allocator (LK_FREE if none).
+/// Returns NULL if arr has no data, or on error.
+void* lk_array_release(lk_array* arr, size_t* size);
+
+/// Makes dest share the data of src without copying it, freeing what dest
+/// held before. The data is copied on the first write through one of the
+/// modifying functions (lk_set, lk_push_back, ...) of either array.
+/// Both have to use the same allocator. Data held inline in src is moved
+/// to the heap first.
+/// Pointers returned by lk_at and lk_get point into the shared data: call
+/// lk_array_unshare before writing through them. Sharing arrays may live on
+/// different threads, but each array may only be used by one at a time.
+bool lk_array_share(lk_array* dest, lk_array* src);
+
+/// Makes sure arr is the only owner of its data, copying it if it's
+/// shared with other arrays.
+bool lk_array_unshare(lk_array* arr);
+
+/// Returns true if arr shares its data with at least one other array.
+bool lk_array_is_shared(lk_array* arr);
+
+/// Returns a view of count elements starting at index, without copying.
+/// On error, the returned view has data == NULL and size == 0.
+lk_array_view lk_array_slice(lk_array* arr, size_t index, size_t count);
+
+/// Macro for simple access to values of specific type in a view.
+/// Beware: returns NULL on failure.
+#define lk_view_at(view, type, index) \
+    (type*)lk_view_at_raw(view, index)
+
+/// Returns a void pointer to the specified index in the view.
+/// Returns NULL on failure (does bounds checking).
+void* lk_view_at_raw(lk_array_view* view, size_t index);
+
 /// Pushes back (appends) the element pointed to by buf.
 /// buf may *not* be NULL. Only arr->memb_size bytes will be copied
 /// from buf. arr will be resized in the process.
 /// Returns false on error, true on success.
 bool lk_push_back(lk_array* arr, void* buf);
 
+/// Appends count elements from buf, which has to hold at least
+/// count * arr->memb_size bytes. Grows arr at most once and copies
+/// all elements in one go.
+/// Returns false on error, true on success.
+bool lk_append_n(lk_array* arr, void* buf, size_t count);
+
+/// Inserts count elements from buf before index, shifting all following
+/// elements back. index may be arr->size, which is equivalent to lk_append_n.
+/// buf may not point into arr.
+/// Returns false on error, true on success.
+bool lk_insert_range(lk_array* arr, size_t index, void* buf, size_t count);
+
+/// Removes count elements starting at index, shifting all following
+/// elements forward. Does not reduce capacity.
+/// Returns false on error, true on success.
+bool lk_erase_range(lk_array* arr, size_t index, size_t count);
+
+/// Removes the last element. If out is not NULL, the element is copied
+/// to out first. Will fail if arr is empty.
+/// Returns false on error, true on success.
+bool lk_pop_back(lk_array* arr, void* out);
+
+/// Removes the element at index by moving the last element into its place.
+/// Does not preserve the order of elements, but runs in O(1).
+/// Returns false on error, true on success.
+bool lk_swap_remove(lk_array* arr, size_t index);
+
 /// Reserves (pre-allocates) enough memory to hold new_size elements of size
 /// arr->memb_size. Allows for resizing up to new_size without
 /// new allocations.
@@ -73,8 +242,30 @@ bool lk_reserve(lk_array* arr, size_t new_size);
 /// Discards elements if new_size < arr->size (shrinking).
 /// Note that this isn't memory-greedy and will *not* reallocate if shrinking
 /// occurs. The capacity may remain the same after this.
+/// If growing past the capacity, exactly new_size elements are allocated
+/// (the growth policy is not applied).
+/// New elements are zeroed.
 bool lk_resize(lk_array* arr, size_t new_size);
 
+/// Like lk_resize, but new elements are left uninitialized.
+bool lk_resize_uninit(lk_array* arr, size_t new_size);
+
+/// Internal function that grows the capacity of arr according to its growth
+/// policy, so that it can hold at least needed elements. Use lk_reserve instead.
+/// Fails if needed elements would take more than SIZE_MAX bytes.
+bool lk_grow_internal(lk_array* arr, size_t needed);
+
+/// Internal function that frees the data of arr (or drops its reference to
+/// shared data) and empties it, so it can hold elements of memb_size next.
+/// Used where the old elements would be overwritten anyway.
+bool lk_discard_internal(lk_array* arr, size_t memb_size);
+
+/// Sets the growth policy used when lk_push_back needs more space.
+/// Capacity is multiplied by growth_factor (must be > 1.0, e.g. 1.5 or 2.0),
+/// and is at least min_capacity after the first growth.
+/// Arrays start out with LK_DEFAULT_GROWTH_FACTOR and LK_DEFAULT_MIN_CAPACITY.
+bool lk_set_growth_policy(lk_array* arr, double growth_factor, size_t min_capacity);
+
 /// Macro for simple access to values of specific type.
 /// Usage: int* my_value = lk_at(the_array, int, 5)
 /// to get index 5 as int*. Beware: returns NULL on failure.
@@ -97,6 +288,87 @@ void* lk_get_raw(lk_array* arr);
 /// Does bounds checking, returns false on failure.
 bool lk_set(lk_array* arr, size_t index, void* value);
 
+/*
+ * Instrumentation:
+ *
+ * If LK_STATS is defined, every array counts reallocations, bytes moved,
+ * allocator calls and bounds check failures, and tracks its peak capacity.
+ * The same counters are kept for the whole process. Without LK_STATS,
+ * none of this is compiled in, and the functions below fail.
+ */
+
+/// Copies the counters of arr into out. Returns false if compiled without
+/// LK_STATS.
+bool lk_array_stats(lk_array* arr, lk_stats* out);
+
+/// Copies the process-wide counters into out. peak_capacity is the largest
+/// capacity any array reached, wasted_capacity is always 0.
+/// Returns false if compiled without LK_STATS.
+bool lk_global_stats(lk_stats* out);
+
+/// Sets a hook to be called after each reallocation, NULL to unset it.
+/// Does nothing if compiled without LK_STATS.
+void lk_set_realloc_hook(lk_realloc_hook fn);
+
+/*
+ * Unchecked access:
+ *
+ * The following accessors do no NULL or bounds checking and are inlined,
+ * for use in loops where the caller has already checked the bounds.
+ * The checks are done as assert()s instead, so they are removed
+ * when NDEBUG is defined.
+ *
+ * If LK_UNCHECKED_ACCESS is defined before this include, lk_at, lk_at_raw,
+ * lk_get, lk_get_raw and lk_set use these accessors, too.
+ */
+
+/// Macro for unchecked access to values of specific type.
+/// sizeof(type) has to match arr->memb_size. Compiles to the same code
+/// as indexing a type* directly.
+#define lk_at_unchecked(arr, type, index) \
+    (type*)lk_at_sized_unchecked(arr, index, sizeof(type))
+
+/// Returns a pointer to the specified index in the array, which holds
+/// elements of size memb_size. Used by lk_at_unchecked.
+static inline void* lk_at_sized_unchecked(lk_array* arr, size_t index, size_t memb_size) {
+    assert(arr && arr->data && index < arr->size && memb_size == arr->memb_size);
+    return (char*)arr->data + index * memb_size;
+}
+
+/// Unchecked version of lk_at_raw.
+static inline void* lk_at_raw_unchecked(lk_array* arr, size_t index) {
+    assert(arr && arr->data && index < arr->size);
+    return (char*)arr->data + index * arr->memb_size;
+}
+
+/// Unchecked version of lk_get_raw.
+static inline void* lk_get_raw_unchecked(lk_array* arr) {
+    assert(arr);
+    return arr->data;
+}
+
+/// Unchecked version of lk_set. Skips the bounds and NULL checks, but
+/// still unshares arr's data first (see lk_array_share). Only returns
+/// false if that fails.
+static inline bool lk_set_unchecked(lk_array* arr, size_t index, void* value) {
+    assert(arr && arr->data && value && index < arr->size);
+    if (arr->shared && !lk_array_unshare(arr)) {
+        return false;
+    }
+    memcpy((char*)arr->data + index * arr->memb_size, value, arr->memb_size);
+    return true;
+}
+
+#ifdef LK_UNCHECKED_ACCESS
+#undef lk_at
+#undef lk_get
+#define lk_at(arr, type, index) lk_at_unchecked(arr, type, index)
+#define lk_get(arr, type) (type*)lk_get_raw_unchecked(arr)
+#define lk_at_raw(arr, index) lk_at_raw_unchecked(arr, index)
+#define lk_get_raw(arr) lk_get_raw_unchecked(arr)
+#define lk_set(arr, index, value) lk_set_unchecked(arr, index, value)
+#endif // LK_UNCHECKED_ACCESS
+
 /*
  * Error handling: 
  *
@@ -107,6 +379,11 @@ bool lk_set(lk_array* arr, size_t index, void* value);
  *
  * To set a default error callback (fprintf to stderr) call 
  * lk_set_error_callback_stderr. This is great for setting up a quick project.
+ *
+ * Independent of the callback, every failing call stores an error code
+ * that can be queried with lk_last_error. Like errno, it is thread-local
+ * and is not reset by successful calls. Error messages are only formatted
+ * if a callback is installed, so failing calls are cheap without one.
  */
 /// Sets the error callback to be called when an error occurs.
 /// Signature: void(const char*)
@@ -114,4 +391,116 @@ void lk_setup_error_callback(callback_ptr fn);
 /// Resets the error callback to one which prints the error to stderr.
 void lk_setup_error_callback_stderr(void);
 
+/// Returns the error code of the last failed call on this thread.
+lk_error lk_last_error(void);
+/// Resets the error code returned by lk_last_error to LK_OK.
+void lk_clear_error(void);
+/// Returns a short description of the given error code.
+const char* lk_error_string(lk_error code);
+
+/// Internal function that sets the last error and passes the message
+/// to the error callback.
+void lk_report_error_internal(lk_error code, const char* func, const char* str);
+
+/*
+ * Type-specialized arrays:
+ *
+ * LK_ARRAY_DECLARE(name, T) declares a struct `name` wrapping an lk_array
+ * holding elements of type T, and the following static inline functions:
+ *      name*     name_new(size_t size)
+ *      void      name_free(name* arr)
+ *      T*        name_data(name* arr)
+ *      T*        name_at(name* arr, size_t index)
+ *      bool      name_set(name* arr, size_t index, T value)
+ *      bool      name_push(name* arr, T value)
+ *      bool      name_reserve(name* arr, size_t new_size)
+ *      lk_array* name_as_array(name* arr)
+ *      name*     name_from_array(lk_array* arr)
+ * These behave like their lk_array counterparts, but since the element type
+ * is known at compile time, accesses compile down to plain typed loads and
+ * stores instead of a multiply and a memcpy of memb_size bytes.
+ * Growth goes through the same growth policy and allocator macros as lk_array.
+ *
+ * Converting to and from lk_array is free, the typed array *is* an lk_array.
+ * name_from_array fails (returns NULL) if arr->memb_size != sizeof(T).
+ *
+ * Usage:
+ *      LK_ARRAY_DECLARE(float_array, float)
+ *      float_array* arr = float_array_new(0);
+ *      float_array_push(arr, 1.0f);
+ *      float* f = float_array_at(arr, 0);
+ *      float_array_free(arr);
+ */
+#define LK_ARRAY_DECLARE(name, T)                                                  \
+    typedef struct {                                                               \
+        lk_array base;                                                             \
+    } name;                                                                        \
+                                                                                   \
+    static inline name* name##_new(size_t size) {                                  \
+        return (name*)lk_new_array(size, sizeof(T));                               \
+    }                                                                              \
+                                                                                   \
+    static inline void name##_free(name* arr) {                                    \
+        lk_free_array_internal(arr ? &arr->base : NULL);                           \
+    }                                                                              \
+                                                                                   \
+    static inline lk_array* name##_as_array(name* arr) {                           \
+        return arr ? &arr->base : NULL;                                            \
+    }                                                                              \
+                                                                                   \
+    static inline name* name##_from_array(lk_array* arr) {                         \
+        if (arr && arr->memb_size != sizeof(T)) {                                  \
+            lk_report_error_internal(LK_ERR_INVALID_ARG, __func__,                 \
+                                     "memb_size does not match type");             \
+            return NULL;                                                           \
+        }                                                                          \
+        return (name*)arr;                                                         \
+    }                                                                              \
+                                                                                   \
+    static inline T* name##_data(name* arr) {                                      \
+        return arr ? (T*)arr->base.data : NULL;                                    \
+    }                                                                              \
+                                                                                   \
+    static inline T* name##_at(name* arr, size_t index) {                          \
+        if (!arr || index >= arr->base.size) {                                     \
+            lk_report_error_internal(LK_ERR_OUT_OF_BOUNDS, __func__,               \
+                                     "index out of bounds");                       \
+            return NULL;                                                           \
+        }                                                                          \
+        return (T*)arr->base.data + index;                                         \
+    }                                                                              \
+                                                                                   \
+    static inline bool name##_set(name* arr, size_t index, T value) {              \
+        if (!arr || index >= arr->base.size) {                                     \
+            lk_report_error_internal(LK_ERR_OUT_OF_BOUNDS, __func__,               \
+                                     "index out of bounds");                       \
+            return false;                                                          \
+        }                                                                          \
+        if (arr->base.shared && !lk_array_unshare(&arr->base)) {                   \
+            return false;                                                          \
+        }                                                                          \
+        ((T*)arr->base.data)[index] = value;                                       \
+        return true;                                                               \
+    }                                                                              \
+                                                                                   \
+    static inline bool name##_push(name* arr, T value) {                           \
+        if (!arr) {                                                                \
+            lk_report_error_internal(LK_ERR_NULL, __func__, "arr cannot be NULL"); \
+            return false;                                                          \
+        }                                                                          \
+        if (arr->base.size == arr->base.capacity                                   \
+            && !lk_grow_internal(&arr->base, arr->base.size + 1)) {                \
+            return false;                                                          \
+        }                                                                          \
+        if (arr->base.shared && !lk_array_unshare(&arr->base)) {                   \
+            return false;                                                          \
+        }                                                                          \
+        ((T*)arr->base.data)[arr->base.size++] = value;                            \
+        return true;                                                               \
+    }                                                                              \
+                                                                                   \
+    static inline bool name##_reserve(name* arr, size_t new_size) {                \
+        return lk_reserve(arr ? &arr->base : NULL, new_size);                      \
+    }
+
 #endif // LK_ARRAY_H
@@ -0,0 +1,476 @@
+#include "lk_bits.h"
+#include <string.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+#define WORD_BITS 64
+
+static size_t popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_popcountll(x);
+#else
+    size_t count = 0;
+    for (; x; x &= x - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// x may not be 0.
+static size_t ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctzll(x);
+#else
+    size_t n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static size_t words_for(size_t bits) {
+    return bits / WORD_BITS + (bits % WORD_BITS != 0);
+}
+
+// Reallocates *words from old_count to new_count words, zeroing the new ones.
+static bool realloc_words(uint64_t** words, size_t old_count, size_t new_count) {
+    uint64_t* new_words = LK_REALLOCARRAY(*words, new_count, sizeof(uint64_t));
+    if (!new_words) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+    memset(new_words + old_count, 0, (new_count - old_count) * sizeof(uint64_t));
+    *words = new_words;
+    return true;
+}
+
+// Clears bits [from, to), to keep the bits past the size zero.
+static void clear_bits(uint64_t* words, size_t from, size_t to) {
+    if (from >= to) {
+        return;
+    }
+    size_t first = from / WORD_BITS;
+    if (from % WORD_BITS != 0) {
+        words[first] &= ((uint64_t)1 << (from % WORD_BITS)) - 1;
+        ++first;
+    }
+    size_t last = words_for(to);
+    if (last > first) {
+        memset(words + first, 0, (last - first) * sizeof(uint64_t));
+    }
+}
+
+// Returns the capacity to grow to for needed elements, at least doubling.
+static size_t grown_capacity(size_t capacity, size_t needed) {
+    size_t new_capacity = capacity < SIZE_MAX / 2 ? capacity * 2 : needed;
+    if (new_capacity < needed) {
+        new_capacity = needed;
+    }
+    return new_capacity;
+}
+
+lk_bitset* lk_new_bitset(size_t size) {
+    lk_bitset* bits = lk_new(lk_bitset);
+    if (!bits) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    bits->words    = NULL;
+    bits->size     = 0;
+    bits->capacity = 0;
+
+    if (!lk_bitset_resize(bits, size)) {
+        lk_free_bitset_internal(bits);
+        report_error(lk_last_error(), "lk_bitset_resize failed");
+        return NULL;
+    }
+
+    return bits;
+}
+
+void lk_free_bitset_internal(lk_bitset* bits) {
+    if (!bits) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    LK_FREE(bits->words);
+    LK_FREE(bits);
+}
+
+bool lk_bitset_reserve(lk_bitset* bits, size_t new_size) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (new_size <= bits->capacity) {
+        return true;
+    }
+
+    size_t old_count = bits->capacity / WORD_BITS;
+    size_t new_count = words_for(new_size);
+    if (!realloc_words(&bits->words, old_count, new_count)) {
+        return false;
+    }
+    bits->capacity = new_count * WORD_BITS;
+
+    return true;
+}
+
+bool lk_bitset_resize(lk_bitset* bits, size_t new_size) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (new_size > bits->capacity && !lk_bitset_reserve(bits, new_size)) {
+        report_error(lk_last_error(), "lk_bitset_reserve failed");
+        return false;
+    }
+
+    clear_bits(bits->words, new_size, bits->size);
+    bits->size = new_size;
+
+    return true;
+}
+
+bool lk_bitset_push_back(lk_bitset* bits, bool value) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (bits->size == bits->capacity
+        && !lk_bitset_reserve(bits, grown_capacity(bits->capacity, bits->size + 1))) {
+        report_error(lk_last_error(), "lk_bitset_reserve failed");
+        return false;
+    }
+
+    size_t index = bits->size++;
+    bits->words[index / WORD_BITS] |= (uint64_t)value << (index % WORD_BITS);
+
+    return true;
+}
+
+bool lk_bitset_get(lk_bitset* bits, size_t index) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (index >= bits->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    return (bits->words[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+}
+
+bool lk_bitset_set(lk_bitset* bits, size_t index, bool value) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (index >= bits->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    uint64_t mask = (uint64_t)1 << (index % WORD_BITS);
+    if (value) {
+        bits->words[index / WORD_BITS] |= mask;
+    } else {
+        bits->words[index / WORD_BITS] &= ~mask;
+    }
+
+    return true;
+}
+
+bool lk_bitset_flip(lk_bitset* bits, size_t index) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (index >= bits->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    bits->words[index / WORD_BITS] ^= (uint64_t)1 << (index % WORD_BITS);
+
+    return true;
+}
+
+size_t lk_bitset_count(lk_bitset* bits) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t words = words_for(bits->size);
+    for (size_t i = 0; i < words; ++i) {
+        count += popcount64(bits->words[i]);
+    }
+
+    return count;
+}
+
+bool lk_bitset_find_first(lk_bitset* bits, size_t start, size_t* index) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    if (start >= bits->size) {
+        return false;
+    }
+
+    size_t   words = words_for(bits->size);
+    size_t   i     = start / WORD_BITS;
+    uint64_t word  = bits->words[i] & (~(uint64_t)0 << (start % WORD_BITS));
+    while (!word) {
+        if (++i == words) {
+            return false;
+        }
+        word = bits->words[i];
+    }
+
+    if (index) {
+        *index = i * WORD_BITS + ctz64(word);
+    }
+
+    return true;
+}
+
+// Checks the arguments of the bulk operations.
+static bool check_pair(lk_bitset* dest, lk_bitset* src) {
+    if (!dest || !src) {
+        report_error(LK_ERR_NULL, "bitsets cannot be NULL");
+        return false;
+    }
+
+    if (dest->size != src->size) {
+        report_error(LK_ERR_INVALID_ARG, "bitsets have different sizes");
+        return false;
+    }
+
+    return true;
+}
+
+bool lk_bitset_and(lk_bitset* dest, lk_bitset* src) {
+    if (!check_pair(dest, src)) {
+        return false;
+    }
+
+    size_t words = words_for(dest->size);
+    for (size_t i = 0; i < words; ++i) {
+        dest->words[i] &= src->words[i];
+    }
+
+    return true;
+}
+
+bool lk_bitset_or(lk_bitset* dest, lk_bitset* src) {
+    if (!check_pair(dest, src)) {
+        return false;
+    }
+
+    size_t words = words_for(dest->size);
+    for (size_t i = 0; i < words; ++i) {
+        dest->words[i] |= src->words[i];
+    }
+
+    return true;
+}
+
+bool lk_bitset_xor(lk_bitset* dest, lk_bitset* src) {
+    if (!check_pair(dest, src)) {
+        return false;
+    }
+
+    size_t words = words_for(dest->size);
+    for (size_t i = 0; i < words; ++i) {
+        dest->words[i] ^= src->words[i];
+    }
+
+    return true;
+}
+
+bool lk_bitset_not(lk_bitset* bits) {
+    if (!bits) {
+        report_error(LK_ERR_NULL, "bits cannot be NULL");
+        return false;
+    }
+
+    size_t words = words_for(bits->size);
+    for (size_t i = 0; i < words; ++i) {
+        bits->words[i] = ~bits->words[i];
+    }
+    // the bits past the size have to stay zero
+    clear_bits(bits->words, bits->size, words * WORD_BITS);
+
+    return true;
+}
+
+lk_packed_array* lk_new_packed_array(size_t size, size_t bits) {
+    if (bits == 0 || bits > 16) {
+        report_error(LK_ERR_INVALID_ARG, "bits has to be 1 to 16");
+        return NULL;
+    }
+
+    lk_packed_array* arr = lk_new(lk_packed_array);
+    if (!arr) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    arr->words    = NULL;
+    arr->bits     = bits;
+    arr->size     = 0;
+    arr->capacity = 0;
+
+    if (!lk_packed_resize(arr, size)) {
+        lk_free_packed_array_internal(arr);
+        report_error(lk_last_error(), "lk_packed_resize failed");
+        return NULL;
+    }
+
+    return arr;
+}
+
+void lk_free_packed_array_internal(lk_packed_array* arr) {
+    if (!arr) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    LK_FREE(arr->words);
+    LK_FREE(arr);
+}
+
+bool lk_packed_reserve(lk_packed_array* arr, size_t new_size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (new_size <= arr->capacity) {
+        return true;
+    }
+
+    if (new_size > SIZE_MAX / arr->bits) {
+        report_error(LK_ERR_INVALID_ARG, "new_size too large");
+        return false;
+    }
+
+    size_t old_count = words_for(arr->capacity * arr->bits);
+    size_t new_count = words_for(new_size * arr->bits);
+    if (!realloc_words(&arr->words, old_count, new_count)) {
+        return false;
+    }
+    arr->capacity = new_count * WORD_BITS / arr->bits;
+
+    return true;
+}
+
+bool lk_packed_resize(lk_packed_array* arr, size_t new_size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (new_size > arr->capacity && !lk_packed_reserve(arr, new_size)) {
+        report_error(lk_last_error(), "lk_packed_reserve failed");
+        return false;
+    }
+
+    clear_bits(arr->words, new_size * arr->bits, arr->size * arr->bits);
+    arr->size = new_size;
+
+    return true;
+}
+
+// Writes value to the element at index, which has to be in bounds.
+static void put(lk_packed_array* arr, size_t index, unsigned value) {
+    size_t   pos    = index * arr->bits;
+    size_t   word   = pos / WORD_BITS;
+    size_t   offset = pos % WORD_BITS;
+    uint64_t mask   = ((uint64_t)1 << arr->bits) - 1;
+
+    arr->words[word] = (arr->words[word] & ~(mask << offset)) | ((uint64_t)value << offset);
+    if (offset + arr->bits > WORD_BITS) {
+        // the rest spills into the next word
+        size_t spilled       = WORD_BITS - offset;
+        arr->words[word + 1] = (arr->words[word + 1] & ~(mask >> spilled)) | ((uint64_t)value >> spilled);
+    }
+}
+
+bool lk_packed_push_back(lk_packed_array* arr, unsigned value) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (value >> arr->bits) {
+        report_error(LK_ERR_INVALID_ARG, "value does not fit into arr->bits bits");
+        return false;
+    }
+
+    if (arr->size == arr->capacity && !lk_packed_reserve(arr, grown_capacity(arr->capacity, arr->size + 1))) {
+        report_error(lk_last_error(), "lk_packed_reserve failed");
+        return false;
+    }
+
+    put(arr, arr->size++, value);
+
+    return true;
+}
+
+unsigned lk_packed_get(lk_packed_array* arr, size_t index) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return 0;
+    }
+
+    if (index >= arr->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return 0;
+    }
+
+    size_t   pos    = index * arr->bits;
+    size_t   word   = pos / WORD_BITS;
+    size_t   offset = pos % WORD_BITS;
+    uint64_t value  = arr->words[word] >> offset;
+    if (offset + arr->bits > WORD_BITS) {
+        value |= arr->words[word + 1] << (WORD_BITS - offset);
+    }
+
+    return (unsigned)(value & (((uint64_t)1 << arr->bits) - 1));
+}
+
+bool lk_packed_set(lk_packed_array* arr, size_t index, unsigned value) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (index >= arr->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    if (value >> arr->bits) {
+        report_error(LK_ERR_INVALID_ARG, "value does not fit into arr->bits bits");
+        return false;
+    }
+
+    put(arr, index, value);
+
+    return true;
+}
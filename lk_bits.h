@@ -0,0 +1,125 @@
+#ifndef LK_BITS_H
+#define LK_BITS_H
+
+/*
+ * lk_bits.h
+ *
+ * Defines interface for handling bit-packed arrays:
+ * - lk_bitset, an array of booleans stored as one bit each, and
+ * - lk_packed_array, an array of unsigned integers of 1 to 16 bits each,
+ *   such as small enums.
+ *
+ * Both store their bits in 64-bit words, and work a word at a time where
+ * they can: counting, searching and the bulk operations of lk_bitset
+ * touch every word once, instead of every bit.
+ * Bits past the size are always kept zero.
+ *
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+#include <stdint.h>
+
+/// Structure that holds all data concerning a bitset.
+/// Bit i is bit (i % 64) of words[i / 64].
+typedef struct {
+    uint64_t* words;
+    // in bits
+    size_t size;
+    size_t capacity;
+} lk_bitset;
+
+/// Macro to use for freeing lk_bitsets. Sets ptr to NULL.
+#define lk_free_bitset(ptr)           \
+    do {                              \
+        lk_free_bitset_internal(ptr); \
+        ptr = NULL;                   \
+    } while (0)
+
+/// Allocates a new bitset of size bits, all cleared.
+/// The returned pointer may be NULL on error.
+lk_bitset* lk_new_bitset(size_t size);
+
+/// Internal free() function. Use lk_free_bitset instead.
+void lk_free_bitset_internal(lk_bitset* bits);
+
+/// Makes room for new_size bits. Only increases capacity.
+bool lk_bitset_reserve(lk_bitset* bits, size_t new_size);
+
+/// Resizes bits to new_size bits. New bits are cleared.
+bool lk_bitset_resize(lk_bitset* bits, size_t new_size);
+
+/// Appends a bit.
+bool lk_bitset_push_back(lk_bitset* bits, bool value);
+
+/// Returns the bit at index. Returns false on error.
+bool lk_bitset_get(lk_bitset* bits, size_t index);
+
+/// Sets the bit at index to value.
+bool lk_bitset_set(lk_bitset* bits, size_t index, bool value);
+
+/// Flips the bit at index.
+bool lk_bitset_flip(lk_bitset* bits, size_t index);
+
+/// Returns the number of set bits. Returns 0 on error.
+size_t lk_bitset_count(lk_bitset* bits);
+
+/// Returns true if a bit at or after start is set, and stores the index of
+/// the first one in index (if not NULL).
+bool lk_bitset_find_first(lk_bitset* bits, size_t start, size_t* index);
+
+/// dest = dest & src. Both have to have the same size.
+bool lk_bitset_and(lk_bitset* dest, lk_bitset* src);
+
+/// dest = dest | src. Both have to have the same size.
+bool lk_bitset_or(lk_bitset* dest, lk_bitset* src);
+
+/// dest = dest ^ src. Both have to have the same size.
+bool lk_bitset_xor(lk_bitset* dest, lk_bitset* src);
+
+/// Flips all bits.
+bool lk_bitset_not(lk_bitset* bits);
+
+
+/// Structure that holds all data concerning a packed integer array.
+/// Element i occupies bits [i * bits, (i + 1) * bits) of the words, and
+/// may span two of them.
+typedef struct {
+    uint64_t* words;
+    size_t    bits;
+    size_t    size;
+    size_t    capacity;
+} lk_packed_array;
+
+/// Macro to use for freeing lk_packed_arrays. Sets ptr to NULL.
+#define lk_free_packed_array(ptr)           \
+    do {                                    \
+        lk_free_packed_array_internal(ptr); \
+        ptr = NULL;                         \
+    } while (0)
+
+/// Allocates a new packed array of size zeroed elements of bits bits each,
+/// where bits is 1 to 16.
+/// The returned pointer may be NULL on error.
+lk_packed_array* lk_new_packed_array(size_t size, size_t bits);
+
+/// Internal free() function. Use lk_free_packed_array instead.
+void lk_free_packed_array_internal(lk_packed_array* arr);
+
+/// Makes room for new_size elements. Only increases capacity.
+bool lk_packed_reserve(lk_packed_array* arr, size_t new_size);
+
+/// Resizes arr to new_size elements. New elements are zeroed.
+bool lk_packed_resize(lk_packed_array* arr, size_t new_size);
+
+/// Appends value, which has to fit into arr->bits bits.
+bool lk_packed_push_back(lk_packed_array* arr, unsigned value);
+
+/// Returns the element at index. Returns 0 on error.
+unsigned lk_packed_get(lk_packed_array* arr, size_t index);
+
+/// Sets the element at index to value, which has to fit into arr->bits bits.
+bool lk_packed_set(lk_packed_array* arr, size_t index, unsigned value);
+
+#endif // LK_BITS_H
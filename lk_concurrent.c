@@ -0,0 +1,229 @@
+#include "lk_concurrent.h"
+#include <string.h>
+#include <stdint.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+// Finds the chunk holding index, and the offset into it.
+// Chunk k starts at index (first << k) - first, so adding first to the
+// index makes the chunk number the position of the highest set bit.
+static void locate(lk_concurrent_array* arr, size_t index, size_t* chunk, size_t* offset) {
+    size_t shifted = index + ((size_t)1 << arr->first_shift);
+    size_t bit     = sizeof(size_t) * 8 - 1;
+#if defined(__GNUC__) || defined(__clang__)
+    bit -= (size_t)__builtin_clzl(shifted);
+#else
+    while (!(shifted >> bit)) {
+        --bit;
+    }
+#endif
+    *chunk  = bit - arr->first_shift;
+    *offset = shifted - ((size_t)1 << bit);
+}
+
+// Returns the block in slot, allocating it with count zeroed elements of
+// size bytes if it doesn't exist yet.
+static void* get_block(_Atomic(void*)* slot, size_t count, size_t size) {
+    void* block = atomic_load_explicit(slot, memory_order_acquire);
+    if (block) {
+        return block;
+    }
+
+    void* new_block = LK_CALLOC(count, size);
+    if (!new_block) {
+        report_error(LK_ERR_ALLOC, "LK_CALLOC failed");
+        return NULL;
+    }
+
+    // another writer may have been faster, in that case use its block
+    if (!atomic_compare_exchange_strong_explicit(slot, &block, new_block,
+            memory_order_acq_rel, memory_order_acquire)) {
+        LK_FREE(new_block);
+        return block;
+    }
+    return new_block;
+}
+
+// Returns chunk k, allocating it if it doesn't exist yet. It's zeroed, so a
+// slot that was lost to a failed allocation reads as zeroes if the chunk is
+// allocated by another writer later.
+static void* get_chunk(lk_concurrent_array* arr, size_t k) {
+    return get_block(&arr->chunks[k], (size_t)1 << (arr->first_shift + k), arr->memb_size);
+}
+
+// Returns the ready flags of chunk k, allocating them if needed.
+static atomic_uchar* get_flags(lk_concurrent_array* arr, size_t k) {
+    return get_block(&arr->ready[k], (size_t)1 << (arr->first_shift + k), sizeof(atomic_uchar));
+}
+
+// Moves published up past all ready slots, and returns it.
+static size_t advance(lk_concurrent_array* arr) {
+    size_t published = atomic_load_explicit(&arr->published, memory_order_acquire);
+    size_t reserved  = atomic_load_explicit(&arr->reserved, memory_order_acquire);
+    size_t ready     = published;
+    while (ready < reserved) {
+        size_t k;
+        size_t offset;
+        locate(arr, ready, &k, &offset);
+        atomic_uchar* flags = k < LK_CONCURRENT_MAX_CHUNKS
+            ? atomic_load_explicit(&arr->ready[k], memory_order_acquire)
+            : NULL;
+        if (!flags || !atomic_load_explicit(&flags[offset], memory_order_acquire)) {
+            break;
+        }
+        ++ready;
+    }
+
+    // other threads may have moved it further in the meantime
+    while (ready > published
+        && !atomic_compare_exchange_weak_explicit(&arr->published, &published, ready,
+            memory_order_acq_rel, memory_order_acquire)) {
+    }
+    return ready > published ? ready : published;
+}
+
+lk_concurrent_array* lk_new_concurrent_array(size_t memb_size, size_t first_chunk_size) {
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    if (first_chunk_size == 0) {
+        first_chunk_size = 64;
+    }
+
+    size_t shift = 0;
+    while (((size_t)1 << shift) < first_chunk_size) {
+        ++shift;
+    }
+    if (shift > 24) {
+        report_error(LK_ERR_INVALID_ARG, "first_chunk_size too large");
+        return NULL;
+    }
+
+    lk_concurrent_array* arr = lk_new(lk_concurrent_array);
+    if (!arr) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < LK_CONCURRENT_MAX_CHUNKS; ++i) {
+        atomic_init(&arr->chunks[i], NULL);
+        atomic_init(&arr->ready[i], NULL);
+    }
+    arr->memb_size   = memb_size;
+    arr->first_shift = shift;
+    atomic_init(&arr->reserved, 0);
+    atomic_init(&arr->published, 0);
+
+    return arr;
+}
+
+void lk_free_concurrent_array_internal(lk_concurrent_array* arr) {
+    if (!arr) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    for (size_t i = 0; i < LK_CONCURRENT_MAX_CHUNKS; ++i) {
+        LK_FREE(atomic_load_explicit(&arr->chunks[i], memory_order_relaxed));
+        LK_FREE(atomic_load_explicit(&arr->ready[i], memory_order_relaxed));
+    }
+    LK_FREE(arr);
+}
+
+bool lk_concurrent_reserve(lk_concurrent_array* arr, size_t new_size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (new_size == 0) {
+        return true;
+    }
+
+    size_t last_chunk;
+    size_t offset;
+    locate(arr, new_size - 1, &last_chunk, &offset);
+    if (last_chunk >= LK_CONCURRENT_MAX_CHUNKS) {
+        report_error(LK_ERR_INVALID_ARG, "new_size too large");
+        return false;
+    }
+
+    for (size_t k = 0; k <= last_chunk; ++k) {
+        if (!get_chunk(arr, k) || !get_flags(arr, k)) {
+            report_error(LK_ERR_ALLOC, "allocating chunk failed");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool lk_concurrent_push_back(lk_concurrent_array* arr, void* buf) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (!buf) {
+        report_error(LK_ERR_NULL, "buf cannot be NULL");
+        return false;
+    }
+
+    size_t index = atomic_fetch_add_explicit(&arr->reserved, 1, memory_order_relaxed);
+
+    size_t k;
+    size_t offset;
+    locate(arr, index, &k, &offset);
+    // the slot is marked as ready even if its chunk couldn't be allocated,
+    // so the size can move past it. lk_concurrent_at_raw fails for it.
+    atomic_uchar* flags = k < LK_CONCURRENT_MAX_CHUNKS ? get_flags(arr, k) : NULL;
+    void*         chunk = k < LK_CONCURRENT_MAX_CHUNKS ? get_chunk(arr, k) : NULL;
+    if (chunk) {
+        memcpy((char*)chunk + offset * arr->memb_size, buf, arr->memb_size);
+    }
+    if (flags) {
+        atomic_store_explicit(&flags[offset], 1, memory_order_release);
+    }
+
+    if (!chunk || !flags) {
+        report_error(LK_ERR_ALLOC, "allocating chunk failed");
+        return false;
+    }
+
+    return true;
+}
+
+size_t lk_concurrent_size(lk_concurrent_array* arr) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return 0;
+    }
+
+    return advance(arr);
+}
+
+void* lk_concurrent_at_raw(lk_concurrent_array* arr, size_t index) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return NULL;
+    }
+
+    if (index >= atomic_load_explicit(&arr->published, memory_order_acquire) && index >= advance(arr)) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return NULL;
+    }
+
+    size_t k;
+    size_t offset;
+    locate(arr, index, &k, &offset);
+    void* chunk = k < LK_CONCURRENT_MAX_CHUNKS
+        ? atomic_load_explicit(&arr->chunks[k], memory_order_acquire)
+        : NULL;
+    if (!chunk) {
+        report_error(LK_ERR_ALLOC, "element was lost to a failed allocation");
+        return NULL;
+    }
+
+    return (char*)chunk + offset * arr->memb_size;
+}
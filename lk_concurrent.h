@@ -0,0 +1,91 @@
+#ifndef LK_CONCURRENT_H
+#define LK_CONCURRENT_H
+
+/*
+ * lk_concurrent.h
+ *
+ * Defines interface for handling the lk_concurrent_array structure, an
+ * append-only array which any number of threads may push to concurrently,
+ * without locks, while others read from it.
+ *
+ * Storage is a fixed directory of chunks, where each chunk is twice as
+ * large as the one before. Chunks are never moved or freed while the array
+ * lives, so growth is a single compare-and-swap of a chunk pointer, and
+ * pointers to elements stay valid.
+ *
+ * Writers claim a slot with an atomic fetch-add, copy their element into
+ * it and mark the slot as ready in a flag of its own, so no writer ever
+ * waits for another. lk_concurrent_size returns the number of ready slots
+ * before the first one that isn't, so a reader sees only fully written
+ * elements. A writer that stalls between claiming and marking its slot
+ * holds back the size (but no other writer) until it is done.
+ *
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+#include <stdatomic.h>
+
+/// Number of entries in the chunk directory.
+#define LK_CONCURRENT_MAX_CHUNKS 48
+
+/// Structure that holds all data concerning a concurrent array.
+/// Chunk k holds (first_chunk_size << k) elements, and ready[k] one flag
+/// for each of them.
+typedef struct {
+    _Atomic(void*) chunks[LK_CONCURRENT_MAX_CHUNKS];
+    // arrays of atomic_uchar, 1 for a ready slot
+    _Atomic(void*) ready[LK_CONCURRENT_MAX_CHUNKS];
+    size_t         memb_size;
+    size_t         first_shift;
+    // number of claimed slots
+    atomic_size_t reserved;
+    // all slots below this are ready. Only ever moves up.
+    atomic_size_t published;
+} lk_concurrent_array;
+
+/// Macro to use for freeing lk_concurrent_arrays. Sets ptr to NULL.
+/// No other thread may use the array at this point.
+#define lk_free_concurrent_array(ptr)           \
+    do {                                        \
+        lk_free_concurrent_array_internal(ptr); \
+        ptr = NULL;                             \
+    } while (0)
+
+/// Allocates a new, empty concurrent array.
+/// first_chunk_size is the number of elements in the first chunk, and is
+/// rounded up to the next power of two. If it's 0, 64 is used.
+/// The returned pointer may be NULL on error.
+lk_concurrent_array* lk_new_concurrent_array(size_t member_size, size_t first_chunk_size);
+
+/// Internal free() function. Use lk_free_concurrent_array instead.
+void lk_free_concurrent_array_internal(lk_concurrent_array* arr);
+
+/// Appends the element pointed to by buf. Thread-safe.
+/// Only arr->memb_size bytes will be copied from buf.
+/// Returns false on error, true on success. If the chunk for the element
+/// can't be allocated, the claimed slot is still marked as ready, and
+/// lk_concurrent_at_raw returns NULL for it (or a zeroed element, if another
+/// writer allocated its chunk later). Only if its flags can't be allocated
+/// either, the slot is never ready and lk_concurrent_size stops before it.
+bool lk_concurrent_push_back(lk_concurrent_array* arr, void* buf);
+
+/// Allocates all chunks needed to hold new_size elements up front, so
+/// lk_concurrent_push_back never allocates below that. Thread-safe.
+bool lk_concurrent_reserve(lk_concurrent_array* arr, size_t new_size);
+
+/// Returns the number of ready elements before the first one that isn't.
+/// All elements below this index are fully written and may be read.
+size_t lk_concurrent_size(lk_concurrent_array* arr);
+
+/// Macro for simple access to values of specific type.
+/// Beware: returns NULL on failure.
+#define lk_concurrent_at(arr, type, index) \
+    (type*)lk_concurrent_at_raw(arr, index)
+
+/// Returns a void pointer to the specified index in the array.
+/// Returns NULL if index is not below lk_concurrent_size yet.
+void* lk_concurrent_at_raw(lk_concurrent_array* arr, size_t index);
+
+#endif // LK_CONCURRENT_H
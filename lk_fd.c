@@ -0,0 +1,176 @@
+#include "lk_fd.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+lk_fd_reader* lk_new_fd_reader(int fd, size_t memb_size) {
+    if (fd < 0) {
+        report_error(LK_ERR_INVALID_ARG, "fd cannot be negative");
+        return NULL;
+    }
+
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    lk_fd_reader* reader = lk_new(lk_fd_reader);
+    if (!reader) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    reader->fd        = fd;
+    reader->memb_size = memb_size;
+    reader->partial   = LK_MALLOC(memb_size);
+    reader->pending   = 0;
+    reader->eof       = false;
+    reader->overflow  = LK_MALLOC(LK_FD_READ_BYTES);
+    if (!reader->partial || !reader->overflow) {
+        lk_free_fd_reader(reader);
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    return reader;
+}
+
+void lk_free_fd_reader_internal(lk_fd_reader* reader) {
+    if (!reader) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+
+    LK_FREE(reader->partial);
+    LK_FREE(reader->overflow);
+    LK_FREE(reader);
+}
+
+// Appends the pending bytes followed by the bytes bytes at src to arr as
+// whole elements, and keeps the rest as pending. src may already be where
+// its bytes belong, right behind the pending ones in the spare capacity.
+static void take_bytes(lk_array* arr, lk_fd_reader* reader, const unsigned char* src, size_t bytes) {
+    size_t         w     = reader->memb_size;
+    size_t         whole = (reader->pending + bytes) / w;
+    unsigned char* dst   = (unsigned char*)arr->data + arr->size * w;
+
+    if (whole == 0) {
+        memcpy(reader->partial + reader->pending, src, bytes);
+        reader->pending += bytes;
+        return;
+    }
+
+    size_t used = whole * w - reader->pending;
+    memcpy(dst, reader->partial, reader->pending);
+    if (dst + reader->pending != src) {
+        memcpy(dst + reader->pending, src, used);
+    }
+    arr->size += whole;
+    reader->pending = bytes - used;
+    memcpy(reader->partial, src + used, reader->pending);
+}
+
+bool lk_append_from_fd(lk_array* arr, lk_fd_reader* reader, size_t* appended) {
+    if (!arr || !reader) {
+        report_error(LK_ERR_NULL, "arr and reader cannot be NULL");
+        return false;
+    }
+
+    if (arr->memb_size != reader->memb_size) {
+        report_error(LK_ERR_INVALID_ARG, "arr has a different memb_size than reader");
+        return false;
+    }
+
+    if (appended) {
+        *appended = 0;
+    }
+
+    // the read goes into the data, which may not be shared
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    size_t w     = arr->memb_size;
+    size_t spare = (arr->capacity - arr->size) * w;
+    if (spare < reader->pending + LK_FD_READ_BYTES) {
+        size_t needed = arr->size + (reader->pending + LK_FD_READ_BYTES + w - 1) / w;
+        if (!lk_grow_internal(arr, needed)) {
+            report_error(lk_last_error(), "lk_grow_internal failed");
+            return false;
+        }
+        spare = (arr->capacity - arr->size) * w;
+    }
+
+    // read behind the pending bytes, so a whole element can be formed in place
+    unsigned char* dst    = (unsigned char*)arr->data + arr->size * w + reader->pending;
+    struct iovec   iov[2] = {
+        { dst, spare - reader->pending },
+        { reader->overflow, LK_FD_READ_BYTES },
+    };
+
+    ssize_t n;
+    do {
+        n = readv(reader->fd, iov, 2);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        report_error(LK_ERR_INVALID_ARG, "readv failed");
+        return false;
+    }
+
+    if (n == 0) {
+        reader->eof = true;
+        return true;
+    }
+
+    size_t old_size    = arr->size;
+    size_t in_array    = (size_t)n < iov[0].iov_len ? (size_t)n : iov[0].iov_len;
+    size_t in_overflow = (size_t)n - in_array;
+    take_bytes(arr, reader, dst, in_array);
+
+    if (in_overflow > 0) {
+        size_t needed = arr->size + (reader->pending + in_overflow) / w;
+        if (!lk_grow_internal(arr, needed)) {
+            report_error(lk_last_error(), "lk_grow_internal failed");
+            return false;
+        }
+        take_bytes(arr, reader, reader->overflow, in_overflow);
+    }
+
+    if (appended) {
+        *appended = arr->size - old_size;
+    }
+
+    return true;
+}
+
+bool lk_write_to_fd(lk_array* arr, int fd) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    const char* p     = arr->data;
+    size_t      bytes = arr->size * arr->memb_size;
+    while (bytes > 0) {
+        ssize_t n = write(fd, p, bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            report_error(LK_ERR_INVALID_ARG, "write failed");
+            return false;
+        }
+        p += n;
+        bytes -= (size_t)n;
+    }
+
+    return true;
+}
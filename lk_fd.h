@@ -0,0 +1,70 @@
+#ifndef LK_FD_H
+#define LK_FD_H
+
+/*
+ * lk_fd.h
+ *
+ * Defines functions for moving the elements of lk_arrays to and from file
+ * descriptors, such as files, pipes and sockets, without going through an
+ * intermediate buffer.
+ *
+ * lk_append_from_fd reads straight into the spare capacity of the array.
+ * A read may return a part of an element at the end: it is held by the
+ * lk_fd_reader until the rest of it arrives with a later call, so only
+ * whole elements are ever appended.
+ *
+ * POSIX only. Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+/// Number of bytes lk_append_from_fd can read past the capacity of the
+/// array, and the least amount of spare capacity it reads into.
+#ifndef LK_FD_READ_BYTES
+#define LK_FD_READ_BYTES ((size_t)64 << 10)
+#endif // LK_FD_READ_BYTES
+
+/// Structure that holds the state of reading elements from an fd.
+typedef struct {
+    int    fd;
+    size_t memb_size;
+    // the first pending bytes of the next element
+    unsigned char* partial;
+    size_t         pending;
+    // set once the end of the file was read
+    bool eof;
+    // LK_FD_READ_BYTES bytes that a read can spill over into
+    unsigned char* overflow;
+} lk_fd_reader;
+
+/// Macro to use for freeing lk_fd_readers. Sets ptr to NULL.
+#define lk_free_fd_reader(ptr)           \
+    do {                                 \
+        lk_free_fd_reader_internal(ptr); \
+        ptr = NULL;                      \
+    } while (0)
+
+/// Allocates a new reader of elements of memb_size bytes from fd. fd is
+/// not closed when the reader is freed.
+/// The returned pointer may be NULL on error.
+lk_fd_reader* lk_new_fd_reader(int fd, size_t memb_size);
+
+/// Internal free() function. Use lk_free_fd_reader instead.
+void lk_free_fd_reader_internal(lk_fd_reader* reader);
+
+/// Reads from the reader's fd once, directly into the spare capacity of
+/// arr, which grows first if it has less than LK_FD_READ_BYTES left. The
+/// read is a readv that continues into the reader's overflow buffer, so
+/// data past the capacity doesn't take another system call: it is copied
+/// in after growing arr.
+/// Stores the number of elements appended in appended (if not NULL). That
+/// is 0 at the end of the file, which also sets reader->eof, and if a
+/// non-blocking fd has no data.
+/// arr has to have the reader's memb_size. Fails if the read fails, or if
+/// growing arr fails, in which case the data that was read is lost.
+bool lk_append_from_fd(lk_array* arr, lk_fd_reader* reader, size_t* appended);
+
+/// Writes all elements of arr to fd, which has to be blocking.
+bool lk_write_to_fd(lk_array* arr, int fd);
+
+#endif // LK_FD_H
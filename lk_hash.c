@@ -0,0 +1,366 @@
+#include "lk_hash.h"
+#include <string.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+#define MIN_CAPACITY 8
+
+#define PRIME_1 0x9e3779b185ebca87ull
+#define PRIME_2 0xc2b2ae3d27d4eb4full
+
+// 2^64 divided by the golden ratio, for fibonacci hashing of home slots.
+#define GOLDEN 0x9e3779b97f4a7c15ull
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t lk_hash_bytes(const void* key, size_t key_size) {
+    const unsigned char* p    = key;
+    uint64_t             hash = PRIME_1 ^ (key_size * PRIME_2);
+    size_t               i    = 0;
+    uint64_t             word;
+
+    for (; i + 8 <= key_size; i += 8) {
+        memcpy(&word, p + i, sizeof(word));
+        hash = rotl(hash ^ rotl(word * PRIME_2, 31) * PRIME_1, 27) * PRIME_1;
+    }
+    if (i < key_size) {
+        word = 0;
+        memcpy(&word, p + i, key_size - i);
+        hash = rotl(hash ^ rotl(word * PRIME_2, 31) * PRIME_1, 27) * PRIME_1;
+    }
+
+    // final avalanche, so every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static bool bytes_equal(const void* a, const void* b, size_t key_size) {
+    return memcmp(a, b, key_size) == 0;
+}
+
+static uint64_t* hash_at(lk_hash_map* map, size_t slot) {
+    return (uint64_t*)map->hashes->data + slot;
+}
+
+static char* key_at(lk_hash_map* map, size_t slot) {
+    return (char*)map->keys->data + slot * map->key_size;
+}
+
+static char* value_at(lk_hash_map* map, size_t slot) {
+    return map->values ? (char*)map->values->data + slot * map->value_size : NULL;
+}
+
+static size_t home(lk_hash_map* map, uint64_t hash) {
+    return (size_t)((hash * GOLDEN) >> map->shift);
+}
+
+// Returns how far the entry with hash in slot is from its home slot.
+static size_t distance(lk_hash_map* map, size_t slot, uint64_t hash) {
+    return (slot - home(map, hash)) & (map->capacity - 1);
+}
+
+// The hash stored for key. 0 marks empty slots, so it's never 0.
+static uint64_t stored_hash(lk_hash_map* map, const void* key) {
+    uint64_t hash = map->hash(key, map->key_size);
+    return hash != 0 ? hash : 1;
+}
+
+// Looks for key with hash. Returns true and stores its slot in slot if it
+// is in the table. Otherwise stores the slot it would have to be inserted
+// at. If key is NULL, only looks for that slot.
+static bool probe(lk_hash_map* map, const void* key, uint64_t hash, size_t* slot) {
+    size_t mask = map->capacity - 1;
+    size_t i    = home(map, hash);
+
+    // the table is never full, so this ends at an empty slot at the latest
+    for (size_t dist = 0;; ++dist, i = (i + 1) & mask) {
+        uint64_t other = *hash_at(map, i);
+        if (other == 0 || distance(map, i, other) < dist) {
+            *slot = i;
+            return false;
+        }
+        if (key && other == hash && map->equal(key_at(map, i), key, map->key_size)) {
+            *slot = i;
+            return true;
+        }
+    }
+}
+
+static void move_slot(lk_hash_map* map, size_t dest, size_t src) {
+    *hash_at(map, dest) = *hash_at(map, src);
+    memcpy(key_at(map, dest), key_at(map, src), map->key_size);
+    if (map->values) {
+        memcpy(value_at(map, dest), value_at(map, src), map->value_size);
+    }
+}
+
+// Puts an entry into slot, shifting the entries from there up to the next
+// empty slot one slot further. This keeps the entries ordered by their home
+// slot, which probe relies on.
+static void place(lk_hash_map* map, size_t slot, uint64_t hash, const void* key, const void* value) {
+    size_t mask = map->capacity - 1;
+    size_t end  = slot;
+    while (*hash_at(map, end) != 0) {
+        end = (end + 1) & mask;
+    }
+    while (end != slot) {
+        size_t prev = (end - 1) & mask;
+        move_slot(map, end, prev);
+        end = prev;
+    }
+
+    *hash_at(map, slot) = hash;
+    memcpy(key_at(map, slot), key, map->key_size);
+    if (map->values) {
+        memcpy(value_at(map, slot), value, map->value_size);
+    }
+}
+
+// Returns the fewest slots that fit count entries, or 0 if that's too many.
+static size_t capacity_for(size_t count) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity - capacity / 8 < count) {
+        if (capacity > SIZE_MAX / 2 / sizeof(uint64_t)) {
+            return 0;
+        }
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Moves all entries into a new table of capacity slots.
+static bool rebuild(lk_hash_map* map, size_t capacity) {
+    lk_hash_map next = *map;
+    next.capacity    = capacity;
+    next.shift       = 64;
+    for (size_t c = capacity; c > 1; c /= 2) {
+        --next.shift;
+    }
+
+    // new keys and values are written before they are read
+    next.hashes = lk_new_array(capacity, sizeof(uint64_t));
+    next.keys   = lk_new_array_uninit(capacity, map->key_size);
+    next.values = map->value_size != 0 ? lk_new_array_uninit(capacity, map->value_size) : NULL;
+    if (!next.hashes || !next.keys || (map->value_size != 0 && !next.values)) {
+        lk_free_array(next.hashes);
+        lk_free_array(next.keys);
+        lk_free_array(next.values);
+        report_error(LK_ERR_ALLOC, "lk_new_array failed");
+        return false;
+    }
+
+    for (size_t i = 0; i < map->capacity; ++i) {
+        uint64_t hash = *hash_at(map, i);
+        if (hash != 0) {
+            size_t slot;
+            probe(&next, NULL, hash, &slot);
+            place(&next, slot, hash, key_at(map, i), value_at(map, i));
+        }
+    }
+
+    lk_free_array(map->hashes);
+    lk_free_array(map->keys);
+    lk_free_array(map->values);
+    *map = next;
+
+    return true;
+}
+
+lk_hash_map* lk_new_hash_map(size_t key_size, size_t value_size, lk_hash_fn hash, lk_key_equal_fn equal) {
+    if (key_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "key_size may never be 0");
+        return NULL;
+    }
+
+    lk_hash_map* map = lk_new(lk_hash_map);
+    if (!map) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    memset(map, 0, sizeof(lk_hash_map));
+    map->key_size   = key_size;
+    map->value_size = value_size;
+    map->hash       = hash ? hash : lk_hash_bytes;
+    map->equal      = equal ? equal : bytes_equal;
+
+    if (!rebuild(map, MIN_CAPACITY)) {
+        LK_FREE(map);
+        report_error(lk_last_error(), "rebuild failed");
+        return NULL;
+    }
+
+    return map;
+}
+
+lk_hash_map* lk_new_hash_set(size_t key_size, lk_hash_fn hash, lk_key_equal_fn equal) {
+    return lk_new_hash_map(key_size, 0, hash, equal);
+}
+
+void lk_free_hash_map_internal(lk_hash_map* map) {
+    if (!map) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+
+    lk_free_array(map->hashes);
+    lk_free_array(map->keys);
+    lk_free_array(map->values);
+    LK_FREE(map);
+}
+
+bool lk_hash_reserve(lk_hash_map* map, size_t count) {
+    if (!map) {
+        report_error(LK_ERR_NULL, "map cannot be NULL");
+        return false;
+    }
+
+    size_t capacity = capacity_for(count);
+    if (capacity == 0) {
+        report_error(LK_ERR_INVALID_ARG, "count too large");
+        return false;
+    }
+
+    if (capacity <= map->capacity) {
+        return true;
+    }
+
+    return rebuild(map, capacity);
+}
+
+bool lk_hash_rehash(lk_hash_map* map, size_t count) {
+    if (!map) {
+        report_error(LK_ERR_NULL, "map cannot be NULL");
+        return false;
+    }
+
+    size_t capacity = capacity_for(count > map->size ? count : map->size);
+    if (capacity == 0) {
+        report_error(LK_ERR_INVALID_ARG, "count too large");
+        return false;
+    }
+
+    return rebuild(map, capacity);
+}
+
+bool lk_hash_insert(lk_hash_map* map, const void* key, const void* value, bool* inserted) {
+    if (!map || !key || (map->values && !value)) {
+        report_error(LK_ERR_NULL, "map, key and value cannot be NULL");
+        return false;
+    }
+
+    uint64_t hash = stored_hash(map, key);
+    size_t   slot;
+    if (probe(map, key, hash, &slot)) {
+        if (map->values) {
+            memcpy(value_at(map, slot), value, map->value_size);
+        }
+        if (inserted) {
+            *inserted = false;
+        }
+        return true;
+    }
+
+    if (map->size + 1 > map->capacity - map->capacity / 8) {
+        if (map->capacity > SIZE_MAX / 2 / sizeof(uint64_t) || !rebuild(map, map->capacity * 2)) {
+            report_error(LK_ERR_ALLOC, "growing the table failed");
+            return false;
+        }
+        probe(map, NULL, hash, &slot);
+    }
+
+    place(map, slot, hash, key, value);
+    ++map->size;
+    if (inserted) {
+        *inserted = true;
+    }
+
+    return true;
+}
+
+void* lk_hash_find(lk_hash_map* map, const void* key) {
+    if (!map || !key) {
+        report_error(LK_ERR_NULL, "map and key cannot be NULL");
+        return NULL;
+    }
+
+    size_t slot;
+    if (!probe(map, key, stored_hash(map, key), &slot)) {
+        return NULL;
+    }
+
+    return map->values ? value_at(map, slot) : key_at(map, slot);
+}
+
+bool lk_hash_contains(lk_hash_map* map, const void* key) {
+    return lk_hash_find(map, key) != NULL;
+}
+
+bool lk_hash_erase(lk_hash_map* map, const void* key) {
+    if (!map || !key) {
+        report_error(LK_ERR_NULL, "map and key cannot be NULL");
+        return false;
+    }
+
+    size_t slot;
+    if (!probe(map, key, stored_hash(map, key), &slot)) {
+        return false;
+    }
+
+    // shift the following entries back, until one is empty or at home
+    size_t mask = map->capacity - 1;
+    for (;;) {
+        size_t   next = (slot + 1) & mask;
+        uint64_t hash = *hash_at(map, next);
+        if (hash == 0 || distance(map, next, hash) == 0) {
+            break;
+        }
+        move_slot(map, slot, next);
+        slot = next;
+    }
+    *hash_at(map, slot) = 0;
+    --map->size;
+
+    return true;
+}
+
+bool lk_hash_clear(lk_hash_map* map) {
+    if (!map) {
+        report_error(LK_ERR_NULL, "map cannot be NULL");
+        return false;
+    }
+
+    memset(map->hashes->data, 0, map->capacity * sizeof(uint64_t));
+    map->size = 0;
+
+    return true;
+}
+
+bool lk_hash_next(lk_hash_map* map, size_t* slot, void** key, void** value) {
+    if (!map || !slot) {
+        report_error(LK_ERR_NULL, "map and slot cannot be NULL");
+        return false;
+    }
+
+    for (size_t i = *slot; i < map->capacity; ++i) {
+        if (*hash_at(map, i) != 0) {
+            if (key) {
+                *key = key_at(map, i);
+            }
+            if (value) {
+                *value = value_at(map, i);
+            }
+            *slot = i + 1;
+            return true;
+        }
+    }
+
+    *slot = map->capacity;
+    return false;
+}
@@ -0,0 +1,108 @@
+#ifndef LK_HASH_H
+#define LK_HASH_H
+
+/*
+ * lk_hash.h
+ *
+ * Defines interface for handling lk_hash_maps, hash tables with keys and
+ * values of any fixed size, and hash sets, which are maps without values.
+ *
+ * The table uses open addressing with Robin Hood linear probing: an entry
+ * that is further from its home slot takes the place of one that is
+ * closer, so no entry is ever far from its home. Erasing shifts the
+ * entries after it back by one slot instead of leaving a tombstone, so
+ * lookups never get slower from erasing.
+ *
+ * The hash of every entry, its key and its value are kept in three
+ * lk_arrays with one element per slot, so keys are compared in place.
+ * The table grows to twice its slots when it is more than 7/8 full.
+ *
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+#include <stdint.h>
+
+/// Hashes the key_size bytes at key.
+typedef uint64_t (*lk_hash_fn)(const void* key, size_t key_size);
+
+/// Returns true if the keys of key_size bytes at a and b are equal.
+typedef bool (*lk_key_equal_fn)(const void* a, const void* b, size_t key_size);
+
+/// Structure that holds all data concerning a hash map or set.
+typedef struct {
+    // per slot, 0 for an empty slot
+    lk_array*       hashes;
+    lk_array*       keys;
+    // NULL for a set
+    lk_array*       values;
+    size_t          key_size;
+    size_t          value_size;
+    size_t          size;
+    size_t          capacity;
+    lk_hash_fn      hash;
+    lk_key_equal_fn equal;
+    // the home slot of a hash is the top bits of its product with an odd
+    // constant, so hashes that only differ in their high bits spread out
+    unsigned        shift;
+} lk_hash_map;
+
+/// Macro to use for freeing lk_hash_maps. Sets ptr to NULL.
+#define lk_free_hash_map(ptr)           \
+    do {                                \
+        lk_free_hash_map_internal(ptr); \
+        ptr = NULL;                     \
+    } while (0)
+
+/// Hashes the key_size bytes at key, 8 at a time. The default lk_hash_fn.
+uint64_t lk_hash_bytes(const void* key, size_t key_size);
+
+/// Allocates a new, empty map from keys of key_size bytes to values of
+/// value_size bytes. A value_size of 0 makes a set. hash may be NULL for
+/// lk_hash_bytes, and equal may be NULL to compare the bytes of the keys.
+/// The returned pointer may be NULL on error.
+lk_hash_map* lk_new_hash_map(size_t key_size, size_t value_size, lk_hash_fn hash, lk_key_equal_fn equal);
+
+/// Allocates a new, empty set of keys of key_size bytes. Same as
+/// lk_new_hash_map with a value_size of 0.
+lk_hash_map* lk_new_hash_set(size_t key_size, lk_hash_fn hash, lk_key_equal_fn equal);
+
+/// Internal free() function. Use lk_free_hash_map instead.
+void lk_free_hash_map_internal(lk_hash_map* map);
+
+/// Makes room for count entries, so that inserting up to count entries
+/// doesn't rehash. Only increases capacity.
+bool lk_hash_reserve(lk_hash_map* map, size_t count);
+
+/// Rebuilds the table with the fewest slots that fit count entries, or the
+/// current entries if there are more. Can shrink the table.
+bool lk_hash_rehash(lk_hash_map* map, size_t count);
+
+/// Inserts key with the value pointed to by value, or overwrites the value
+/// if key is already in the map. value is ignored for sets and may be NULL.
+/// Stores whether key was new in inserted (if not NULL).
+bool lk_hash_insert(lk_hash_map* map, const void* key, const void* value, bool* inserted);
+
+/// Returns a pointer to the value of key, or to the key in the table for a
+/// set. It stays valid until the table changes.
+/// Returns NULL if key is not in the map (no error), or on error.
+void* lk_hash_find(lk_hash_map* map, const void* key);
+
+/// Returns true if key is in the map.
+bool lk_hash_contains(lk_hash_map* map, const void* key);
+
+/// Erases key. Returns false if key is not in the map (no error), or on
+/// error.
+bool lk_hash_erase(lk_hash_map* map, const void* key);
+
+/// Erases all entries, keeping the capacity.
+bool lk_hash_clear(lk_hash_map* map);
+
+/// Iterates over the entries. Start with *slot = 0; every call stores the
+/// key and value (NULL for sets) of the next entry in key and value (if not
+/// NULL) and advances *slot. Returns false when there are no more entries.
+/// The map may not change while iterating.
+bool lk_hash_next(lk_hash_map* map, size_t* slot, void** key, void** value);
+
+#endif // LK_HASH_H
@@ -0,0 +1,261 @@
+#define _GNU_SOURCE
+#include "lk_mapped.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+#define HEADER_SIZE sizeof(lk_mapped_header)
+
+// Grows the file and the mapping to at least size bytes. Never shrinks.
+static bool remap(lk_mapped_array* arr, size_t size) {
+    if (size <= arr->map_size) {
+        return true;
+    }
+
+    if (!arr->writable) {
+        // a private mapping can't grow past the end of the file
+        report_error(LK_ERR_INVALID_ARG, "array is not writable, cannot grow");
+        return false;
+    }
+
+    if (ftruncate(arr->fd, (off_t)size) != 0) {
+        report_error(LK_ERR_ALLOC, "ftruncate failed");
+        return false;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    void* map = mremap(arr->map, arr->map_size, size, MREMAP_MAYMOVE);
+#else
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, arr->fd, 0);
+    if (map != MAP_FAILED) {
+        munmap(arr->map, arr->map_size);
+    }
+#endif
+    if (map == MAP_FAILED) {
+        report_error(LK_ERR_ALLOC, "mremap failed");
+        return false;
+    }
+
+    arr->map      = map;
+    arr->map_size = size;
+
+    return true;
+}
+
+// lk_allocator for the data of the mapped array. There is only ever one
+// block: everything behind the header.
+static void* mapped_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    (void)ptr;
+    (void)old_size;
+    lk_mapped_array* arr = ctx;
+
+    if (new_size > SIZE_MAX - HEADER_SIZE) {
+        report_error(LK_ERR_INVALID_ARG, "size too large");
+        return NULL;
+    }
+
+    if (!remap(arr, HEADER_SIZE + new_size)) {
+        return NULL;
+    }
+
+    return (char*)arr->map + HEADER_SIZE;
+}
+
+static void* mapped_alloc(void* ctx, size_t size) {
+    return mapped_realloc(ctx, NULL, 0, size);
+}
+
+static void mapped_free(void* ctx, void* ptr, size_t size) {
+    // the mapping is released by lk_mapped_close
+    (void)ctx;
+    (void)ptr;
+    (void)size;
+}
+
+static lk_mapped_array* new_mapped(int fd, void* map, size_t map_size, bool writable, size_t memb_size) {
+    lk_mapped_array* arr = lk_new(lk_mapped_array);
+    if (!arr) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    arr->fd                     = fd;
+    arr->map                    = map;
+    arr->map_size               = map_size;
+    arr->writable               = writable;
+    arr->allocator.alloc        = mapped_alloc;
+    arr->allocator.realloc      = mapped_realloc;
+    arr->allocator.free         = mapped_free;
+    arr->allocator.ctx          = arr;
+    arr->allocator.alloc_zeroed = NULL;
+
+    // no data yet, and no counters if LK_STATS is defined
+    memset(&arr->array, 0, sizeof(lk_array));
+    arr->array.memb_size     = memb_size;
+    arr->array.allocator     = &arr->allocator;
+    arr->array.growth_factor = LK_DEFAULT_GROWTH_FACTOR;
+    arr->array.min_capacity  = LK_DEFAULT_MIN_CAPACITY;
+
+    return arr;
+}
+
+lk_mapped_array* lk_mapped_create(const char* path, size_t memb_size) {
+    if (!path) {
+        report_error(LK_ERR_NULL, "path cannot be NULL");
+        return NULL;
+    }
+
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        report_error(LK_ERR_INVALID_ARG, "open failed");
+        return NULL;
+    }
+
+    if (ftruncate(fd, HEADER_SIZE) != 0) {
+        close(fd);
+        report_error(LK_ERR_ALLOC, "ftruncate failed");
+        return NULL;
+    }
+
+    void* map = mmap(NULL, HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        report_error(LK_ERR_ALLOC, "mmap failed");
+        return NULL;
+    }
+
+    lk_mapped_header* header = map;
+    memset(header, 0, HEADER_SIZE);
+    memcpy(header->magic, LK_MAPPED_MAGIC, sizeof(LK_MAPPED_MAGIC));
+    header->version     = LK_MAPPED_VERSION;
+    header->header_size = HEADER_SIZE;
+    header->memb_size   = memb_size;
+    header->size        = 0;
+
+    lk_mapped_array* arr = new_mapped(fd, map, HEADER_SIZE, true, memb_size);
+    if (!arr) {
+        munmap(map, HEADER_SIZE);
+        close(fd);
+        return NULL;
+    }
+
+    return arr;
+}
+
+lk_mapped_array* lk_mapped_open(const char* path, bool writable) {
+    if (!path) {
+        report_error(LK_ERR_NULL, "path cannot be NULL");
+        return NULL;
+    }
+
+    int fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        report_error(LK_ERR_INVALID_ARG, "open failed");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE) {
+        close(fd);
+        report_error(LK_ERR_INVALID_ARG, "file too small");
+        return NULL;
+    }
+
+    size_t map_size = (size_t)st.st_size;
+    void*  map      = mmap(NULL, map_size, PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        report_error(LK_ERR_ALLOC, "mmap failed");
+        return NULL;
+    }
+
+    lk_mapped_header* header   = map;
+    size_t            capacity = 0;
+    bool              valid    = memcmp(header->magic, LK_MAPPED_MAGIC, sizeof(LK_MAPPED_MAGIC)) == 0
+        && header->version == LK_MAPPED_VERSION
+        && header->header_size == HEADER_SIZE
+        && header->memb_size != 0;
+    if (valid) {
+        capacity = (map_size - HEADER_SIZE) / header->memb_size;
+        valid    = header->size <= capacity;
+    }
+    if (!valid) {
+        munmap(map, map_size);
+        close(fd);
+        report_error(LK_ERR_INVALID_ARG, "not a valid lk_mapped_array file");
+        return NULL;
+    }
+
+    lk_mapped_array* arr = new_mapped(fd, map, map_size, writable, (size_t)header->memb_size);
+    if (!arr) {
+        munmap(map, map_size);
+        close(fd);
+        return NULL;
+    }
+
+    arr->array.data     = (char*)map + HEADER_SIZE;
+    arr->array.size     = (size_t)header->size;
+    arr->array.capacity = capacity;
+
+    return arr;
+}
+
+lk_array* lk_mapped_get_array(lk_mapped_array* arr) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return NULL;
+    }
+
+    return &arr->array;
+}
+
+bool lk_mapped_sync(lk_mapped_array* arr, bool async) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (!arr->writable) {
+        report_error(LK_ERR_INVALID_ARG, "array is not writable");
+        return false;
+    }
+
+    lk_mapped_header* header = arr->map;
+    header->size             = arr->array.size;
+
+    if (msync(arr->map, arr->map_size, async ? MS_ASYNC : MS_SYNC) != 0) {
+        report_error(LK_ERR_INVALID_ARG, "msync failed");
+        return false;
+    }
+
+    return true;
+}
+
+void lk_mapped_close_internal(lk_mapped_array* arr) {
+    if (!arr) {
+        // closing a NULL ptr is okay, no error
+        return;
+    }
+
+    if (arr->writable) {
+        lk_mapped_sync(arr, false);
+        // drop the spare capacity from the file
+        size_t used = HEADER_SIZE + arr->array.size * arr->array.memb_size;
+        if (ftruncate(arr->fd, (off_t)used) != 0) {
+            report_error(LK_ERR_INVALID_ARG, "ftruncate failed");
+        }
+    }
+
+    munmap(arr->map, arr->map_size);
+    close(arr->fd);
+    LK_FREE(arr);
+}
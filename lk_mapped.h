@@ -0,0 +1,80 @@
+#ifndef LK_MAPPED_H
+#define LK_MAPPED_H
+
+/*
+ * lk_mapped.h
+ *
+ * Defines interface for handling lk_mapped_arrays, lk_arrays whose data
+ * lives in a shared memory mapping of a file. Opening one maps the file
+ * instead of reading it, so only the pages that are touched get loaded.
+ *
+ * The contained lk_array can be used with all lk_array functions, growing
+ * included: it uses an lk_allocator which grows the file with ftruncate
+ * and the mapping with mremap. Don't free it with lk_free_array, use
+ * lk_mapped_close instead.
+ *
+ * The file starts with an lk_mapped_header, followed by the elements.
+ * The size in the header is only updated by lk_mapped_sync and
+ * lk_mapped_close.
+ *
+ * POSIX only. Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+#include <stdint.h>
+
+#define LK_MAPPED_MAGIC "LKARRAY"
+#define LK_MAPPED_VERSION 1
+
+/// Header at the start of the file. Padded to 64 bytes, so the elements
+/// start on a cache line.
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t memb_size;
+    uint64_t size;
+    uint8_t  reserved[32];
+} lk_mapped_header;
+
+/// Structure that holds all data concerning a file-backed array.
+typedef struct {
+    lk_array     array;
+    lk_allocator allocator;
+    int          fd;
+    void*        map;
+    size_t       map_size;
+    bool         writable;
+} lk_mapped_array;
+
+/// Macro to use for closing lk_mapped_arrays. Sets ptr to NULL.
+#define lk_mapped_close(ptr)           \
+    do {                               \
+        lk_mapped_close_internal(ptr); \
+        ptr = NULL;                    \
+    } while (0)
+
+/// Creates (or truncates) the file at path and maps it as an empty array.
+/// The returned pointer may be NULL on error.
+lk_mapped_array* lk_mapped_create(const char* path, size_t member_size);
+
+/// Opens and maps the file at path, which has to have been created by
+/// lk_mapped_create. If writable is false, the file is mapped privately:
+/// the array may still be modified, but changes are not written back.
+/// The returned pointer may be NULL on error.
+lk_mapped_array* lk_mapped_open(const char* path, bool writable);
+
+/// Returns the lk_array backed by arr's mapping.
+lk_array* lk_mapped_get_array(lk_mapped_array* arr);
+
+/// Writes the current size into the header and flushes the mapping to
+/// the file. If async is true, this only schedules the writes (MS_ASYNC),
+/// otherwise it waits for them (MS_SYNC).
+bool lk_mapped_sync(lk_mapped_array* arr, bool async);
+
+/// Internal close function. Use lk_mapped_close instead.
+/// Syncs, truncates the file to the used size, unmaps and closes it.
+void lk_mapped_close_internal(lk_mapped_array* arr);
+
+#endif // LK_MAPPED_H
@@ -0,0 +1,485 @@
+#include "lk_parallel.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__SSE2__) && !defined(LK_NO_SIMD)
+#define LK_HAVE_STREAM
+#include <emmintrin.h>
+#endif // __SSE2__
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+#define CACHE_LINE 64
+
+// Chunks per thread, so threads that finish early can help out.
+#define CHUNKS_PER_THREAD 4
+
+// The pool. Workers sleep on wake until generation changes, then take
+// chunks of the current job until there are none left.
+static pthread_mutex_t lock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake     = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  finished = PTHREAD_COND_INITIALIZER;
+static pthread_t*      workers  = NULL;
+static size_t          worker_count;
+static size_t          generation;
+static size_t          busy;
+static bool            stopping;
+
+// The current job.
+static void (*job_fn)(size_t chunk, void* ctx);
+static void*         job_ctx;
+static size_t        job_chunks;
+static atomic_size_t job_next;
+
+// Held for the whole of a job, and while starting or stopping workers.
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Requested number of threads, 0 for one per CPU.
+static atomic_size_t wanted_threads = 0;
+
+static _Thread_local bool in_job = false;
+
+static void run_chunks(void) {
+    for (;;) {
+        size_t chunk = atomic_fetch_add_explicit(&job_next, 1, memory_order_relaxed);
+        if (chunk >= job_chunks) {
+            return;
+        }
+        job_fn(chunk, job_ctx);
+    }
+}
+
+static void* worker_main(void* arg) {
+    size_t seen = (size_t)(uintptr_t)arg;
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (!stopping && generation == seen) {
+            pthread_cond_wait(&wake, &lock);
+        }
+        if (stopping) {
+            break;
+        }
+        seen = generation;
+        pthread_mutex_unlock(&lock);
+
+        in_job = true;
+        run_chunks();
+        in_job = false;
+
+        pthread_mutex_lock(&lock);
+        if (--busy == 0) {
+            pthread_cond_signal(&finished);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+size_t lk_parallel_threads(void) {
+    if (wanted_threads != 0) {
+        return wanted_threads;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t)cpus : 1;
+}
+
+// Starts the workers if they aren't running. Called with job_lock held.
+static void start_workers(void) {
+    if (workers) {
+        return;
+    }
+
+    size_t count = lk_parallel_threads() - 1;
+    if (count == 0) {
+        return;
+    }
+
+    workers = LK_REALLOCARRAY(NULL, count, sizeof(pthread_t));
+    if (!workers) {
+        // not fatal, the calling thread does all the work
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return;
+    }
+
+    // no job can be posted while job_lock is held, so the workers start
+    // at the current generation
+    worker_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (pthread_create(&workers[worker_count], NULL, worker_main, (void*)(uintptr_t)generation) != 0) {
+            report_error(LK_ERR_ALLOC, "pthread_create failed");
+            break;
+        }
+        ++worker_count;
+    }
+}
+
+// Stops and joins the workers. Called with job_lock held.
+static void stop_workers(void) {
+    if (!workers) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    for (size_t i = 0; i < worker_count; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    LK_FREE(workers);
+    workers      = NULL;
+    worker_count = 0;
+    stopping     = false;
+}
+
+bool lk_parallel_set_threads(size_t threads) {
+    pthread_mutex_lock(&job_lock);
+    stop_workers();
+    wanted_threads = threads;
+    pthread_mutex_unlock(&job_lock);
+
+    return true;
+}
+
+void lk_parallel_shutdown(void) {
+    pthread_mutex_lock(&job_lock);
+    stop_workers();
+    pthread_mutex_unlock(&job_lock);
+}
+
+// Calls fn for chunks 0 to chunks - 1, spread across the pool.
+static void run(void (*fn)(size_t chunk, void* ctx), void* ctx, size_t chunks) {
+    if (chunks <= 1 || in_job) {
+        for (size_t i = 0; i < chunks; ++i) {
+            fn(i, ctx);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&job_lock);
+    start_workers();
+
+    pthread_mutex_lock(&lock);
+    job_fn     = fn;
+    job_ctx    = ctx;
+    job_chunks = chunks;
+    atomic_store_explicit(&job_next, 0, memory_order_relaxed);
+    busy = worker_count;
+    ++generation;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    in_job = true;
+    run_chunks();
+    in_job = false;
+
+    pthread_mutex_lock(&lock);
+    while (busy != 0) {
+        pthread_cond_wait(&finished, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    pthread_mutex_unlock(&job_lock);
+}
+
+static size_t gcd(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a        = b;
+        b        = t;
+    }
+    return a;
+}
+
+// Returns the number of elements per chunk for count elements of
+// memb_size, so that every chunk starts on a cache line.
+static size_t chunk_elements(size_t count, size_t memb_size) {
+    size_t bytes  = count * memb_size;
+    size_t chunks = lk_parallel_threads() * CHUNKS_PER_THREAD;
+    if (bytes < LK_PARALLEL_MIN_BYTES || chunks <= 1) {
+        return count;
+    }
+
+    size_t chunk_bytes = bytes / chunks;
+    if (chunk_bytes < LK_PARALLEL_MIN_BYTES / CHUNKS_PER_THREAD) {
+        chunk_bytes = LK_PARALLEL_MIN_BYTES / CHUNKS_PER_THREAD;
+    }
+
+    // the smallest number of elements that fills whole cache lines
+    size_t step     = CACHE_LINE / gcd(CACHE_LINE, memb_size);
+    size_t elements = chunk_bytes / memb_size;
+    elements        = (elements + step - 1) / step * step;
+    return elements < count ? elements : count;
+}
+
+// Copies n bytes, with non-temporal stores if stream is true.
+static void copy_bytes(char* dst, const char* src, size_t n, bool stream) {
+#ifdef LK_HAVE_STREAM
+    if (stream) {
+        size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+        head        = head < n ? head : n;
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        n -= head;
+        for (; n >= 64; n -= 64, dst += 64, src += 64) {
+            _mm_stream_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+            _mm_stream_si128((__m128i*)dst + 1, _mm_loadu_si128((const __m128i*)src + 1));
+            _mm_stream_si128((__m128i*)dst + 2, _mm_loadu_si128((const __m128i*)src + 2));
+            _mm_stream_si128((__m128i*)dst + 3, _mm_loadu_si128((const __m128i*)src + 3));
+        }
+        memcpy(dst, src, n);
+        // make the streamed stores visible before the job is done
+        _mm_sfence();
+        return;
+    }
+#else
+    (void)stream;
+#endif // LK_HAVE_STREAM
+    memcpy(dst, src, n);
+}
+
+struct copy_job {
+    char*       dst;
+    const char* src;
+    size_t      chunk_bytes;
+    size_t      bytes;
+    bool        stream;
+};
+
+static void copy_chunk(size_t chunk, void* ctx) {
+    struct copy_job* job    = ctx;
+    size_t           offset = chunk * job->chunk_bytes;
+    size_t           n      = job->bytes - offset < job->chunk_bytes ? job->bytes - offset : job->chunk_bytes;
+    copy_bytes(job->dst + offset, job->src + offset, n, job->stream);
+}
+
+bool lk_parallel_copy(lk_array* dest, lk_array* src) {
+    if (!dest || !src) {
+        report_error(LK_ERR_NULL, "arrays cannot be NULL");
+        return false;
+    }
+
+    if (dest == src) {
+        return true;
+    }
+
+    // drop the old data first, so growing doesn't copy it. Shared data
+    // isn't written to either, dest just lets go of it.
+    if (dest->memb_size != src->memb_size || dest->capacity < src->size || dest->shared) {
+        if (!lk_discard_internal(dest, src->memb_size)) {
+            report_error(lk_last_error(), "lk_discard_internal failed");
+            return false;
+        }
+    }
+    if (!lk_resize_uninit(dest, src->size)) {
+        report_error(lk_last_error(), "lk_resize_uninit failed");
+        return false;
+    }
+
+    size_t count = src->size;
+    if (count == 0) {
+        return true;
+    }
+
+    size_t          elements = chunk_elements(count, src->memb_size);
+    struct copy_job job      = {
+        dest->data,
+        src->data,
+        elements * src->memb_size,
+        count * src->memb_size,
+        count * src->memb_size >= LK_PARALLEL_STREAM_BYTES,
+    };
+    run(copy_chunk, &job, (count + elements - 1) / elements);
+
+    return true;
+}
+
+struct fill_job {
+    char*       data;
+    const void* value;
+    size_t      memb_size;
+    size_t      chunk_bytes;
+    size_t      bytes;
+    bool        stream;
+};
+
+static void fill_chunk(size_t chunk, void* ctx) {
+    struct fill_job* job    = ctx;
+    size_t           offset = chunk * job->chunk_bytes;
+    size_t           n      = job->bytes - offset < job->chunk_bytes ? job->bytes - offset : job->chunk_bytes;
+    char*            dst    = job->data + offset;
+    size_t           w      = job->memb_size;
+
+    if (CACHE_LINE % w != 0) {
+        // copy the filled part onto the rest, doubling it every time
+        memcpy(dst, job->value, w);
+        for (size_t filled = w; filled < n; filled *= 2) {
+            memcpy(dst + filled, dst, filled < n - filled ? filled : n - filled);
+        }
+        return;
+    }
+
+    // chunks start on whole patterns, since they start on cache lines.
+    // The pattern is twice as long, so it can be read from any offset.
+    char pattern[2 * CACHE_LINE];
+    for (size_t i = 0; i < sizeof(pattern); i += w) {
+        memcpy(pattern + i, job->value, w);
+    }
+#ifdef LK_HAVE_STREAM
+    if (job->stream) {
+        size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+        head        = head < n ? head : n;
+        memcpy(dst, pattern, head);
+        __m128i p0 = _mm_loadu_si128((const __m128i*)(pattern + head));
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(pattern + head) + 1);
+        __m128i p2 = _mm_loadu_si128((const __m128i*)(pattern + head) + 2);
+        __m128i p3 = _mm_loadu_si128((const __m128i*)(pattern + head) + 3);
+        size_t  i  = head;
+        for (; n - i >= 64; i += 64) {
+            _mm_stream_si128((__m128i*)(dst + i), p0);
+            _mm_stream_si128((__m128i*)(dst + i) + 1, p1);
+            _mm_stream_si128((__m128i*)(dst + i) + 2, p2);
+            _mm_stream_si128((__m128i*)(dst + i) + 3, p3);
+        }
+        memcpy(dst + i, pattern + head, n - i);
+        _mm_sfence();
+        return;
+    }
+#endif // LK_HAVE_STREAM
+    size_t i = 0;
+    for (; i + CACHE_LINE <= n; i += CACHE_LINE) {
+        memcpy(dst + i, pattern, CACHE_LINE);
+    }
+    memcpy(dst + i, pattern, n - i);
+}
+
+bool lk_parallel_fill(lk_array* arr, const void* value) {
+    if (!arr || !value) {
+        report_error(LK_ERR_NULL, "arr and value cannot be NULL");
+        return false;
+    }
+
+    size_t count = arr->size;
+    if (count == 0) {
+        return true;
+    }
+
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    size_t          elements = chunk_elements(count, arr->memb_size);
+    struct fill_job job      = {
+        arr->data,
+        value,
+        arr->memb_size,
+        elements * arr->memb_size,
+        count * arr->memb_size,
+        count * arr->memb_size >= LK_PARALLEL_STREAM_BYTES,
+    };
+    run(fill_chunk, &job, (count + elements - 1) / elements);
+
+    return true;
+}
+
+struct for_each_job {
+    lk_array*   arr;
+    lk_range_fn fn;
+    void*       ctx;
+    size_t      elements;
+};
+
+static void for_each_chunk(size_t chunk, void* ctx) {
+    struct for_each_job* job   = ctx;
+    size_t               first = chunk * job->elements;
+    size_t               count = job->arr->size - first < job->elements ? job->arr->size - first : job->elements;
+    job->fn((char*)job->arr->data + first * job->arr->memb_size, count, first, job->ctx);
+}
+
+bool lk_parallel_for_each(lk_array* arr, lk_range_fn fn, void* ctx) {
+    if (!arr || !fn) {
+        report_error(LK_ERR_NULL, "arr and fn cannot be NULL");
+        return false;
+    }
+
+    size_t count = arr->size;
+    if (count == 0) {
+        return true;
+    }
+
+    if (!lk_array_unshare(arr)) {
+        report_error(lk_last_error(), "lk_array_unshare failed");
+        return false;
+    }
+
+    size_t              elements = chunk_elements(count, arr->memb_size);
+    struct for_each_job job      = { arr, fn, ctx, elements };
+    run(for_each_chunk, &job, (count + elements - 1) / elements);
+
+    return true;
+}
+
+struct reduce_job {
+    lk_array*    arr;
+    lk_reduce_fn reduce;
+    void*        ctx;
+    size_t       elements;
+    char*        partials;
+    size_t       result_size;
+};
+
+static void reduce_chunk(size_t chunk, void* ctx) {
+    struct reduce_job* job   = ctx;
+    size_t             first = chunk * job->elements;
+    size_t             count = job->arr->size - first < job->elements ? job->arr->size - first : job->elements;
+    job->reduce(job->partials + chunk * job->result_size, (char*)job->arr->data + first * job->arr->memb_size,
+        count, job->ctx);
+}
+
+bool lk_parallel_reduce(lk_array* arr, void* result, size_t result_size, const void* identity,
+    lk_reduce_fn reduce, lk_combine_fn combine, void* ctx) {
+    if (!arr || !result || !identity || !reduce || !combine) {
+        report_error(LK_ERR_NULL, "arguments cannot be NULL");
+        return false;
+    }
+
+    if (result_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "result_size may never be 0");
+        return false;
+    }
+
+    memcpy(result, identity, result_size);
+    size_t count = arr->size;
+    if (count == 0) {
+        return true;
+    }
+
+    size_t elements = chunk_elements(count, arr->memb_size);
+    size_t chunks   = (count + elements - 1) / elements;
+    char*  partials = LK_REALLOCARRAY(NULL, chunks, result_size);
+    if (!partials) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+    for (size_t i = 0; i < chunks; ++i) {
+        memcpy(partials + i * result_size, identity, result_size);
+    }
+
+    struct reduce_job job = { arr, reduce, ctx, elements, partials, result_size };
+    run(reduce_chunk, &job, chunks);
+
+    for (size_t i = 0; i < chunks; ++i) {
+        combine(result, partials + i * result_size, ctx);
+    }
+    LK_FREE(partials);
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef LK_PARALLEL_H
+#define LK_PARALLEL_H
+
+/*
+ * lk_parallel.h
+ *
+ * Defines bulk operations on lk_arrays which are spread across all cores
+ * by an internal pool of pthreads.
+ *
+ * The array is split into chunks which start on cache lines (relative to
+ * the start of the data), so no two threads write to the same line. The
+ * calling thread works on chunks too, and the functions return once all
+ * chunks are done. Arrays smaller than LK_PARALLEL_MIN_BYTES are handled
+ * by the calling thread alone.
+ *
+ * The pool is started on first use. Only one operation runs on it at a
+ * time: concurrent calls from several threads wait for each other, and
+ * calls from inside a callback run on the calling thread alone.
+ *
+ * POSIX only. Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+/// Arrays smaller than this are not split up.
+#ifndef LK_PARALLEL_MIN_BYTES
+#define LK_PARALLEL_MIN_BYTES ((size_t)1 << 20)
+#endif // LK_PARALLEL_MIN_BYTES
+
+/// Copies of at least this many bytes use non-temporal stores, which
+/// bypass the cache instead of evicting everything else from it.
+#ifndef LK_PARALLEL_STREAM_BYTES
+#define LK_PARALLEL_STREAM_BYTES ((size_t)16 << 20)
+#endif // LK_PARALLEL_STREAM_BYTES
+
+/// Called for a range of count elements starting at first, which is the
+/// element at index. ctx is passed through.
+typedef void (*lk_range_fn)(void* first, size_t count, size_t index, void* ctx);
+
+/// Folds count elements starting at first into the accumulator acc.
+typedef void (*lk_reduce_fn)(void* acc, const void* first, size_t count, void* ctx);
+
+/// Combines the accumulator other into acc.
+typedef void (*lk_combine_fn)(void* acc, const void* other, void* ctx);
+
+/// Sets the number of threads used, including the calling one. 0 means
+/// one per online CPU, which is the default. Stops the current workers;
+/// new ones are started on the next call.
+bool lk_parallel_set_threads(size_t threads);
+
+/// Returns the number of threads used, including the calling one.
+size_t lk_parallel_threads(void);
+
+/// Stops and joins all worker threads. They are restarted on the next call.
+void lk_parallel_shutdown(void);
+
+/// Like lk_array_deep_copy, but copies in parallel.
+bool lk_parallel_copy(lk_array* dest, lk_array* src);
+
+/// Like lk_fill (see lk_algorithm.h), but fills in parallel.
+bool lk_parallel_fill(lk_array* arr, const void* value);
+
+/// Calls fn for every chunk of arr in parallel. fn may modify the
+/// elements, so arr is unshared first (see lk_array_share).
+bool lk_parallel_for_each(lk_array* arr, lk_range_fn fn, void* ctx);
+
+/// Reduces arr to result, an accumulator of result_size bytes. Every chunk
+/// gets an accumulator starting as a copy of identity, which reduce folds
+/// the chunk into. The accumulators are then combined into result, which
+/// also starts as identity, in the order of the chunks.
+bool lk_parallel_reduce(lk_array* arr, void* result, size_t result_size, const void* identity,
+    lk_reduce_fn reduce, lk_combine_fn combine, void* ctx);
+
+#endif // LK_PARALLEL_H
@@ -0,0 +1,309 @@
+#include "lk_ring.h"
+#include <string.h>
+#include <stdint.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+// Rounds n up to the next power of two. Returns 0 if that overflows.
+static size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        if (p > SIZE_MAX / 2) {
+            return 0;
+        }
+        p <<= 1;
+    }
+    return p;
+}
+
+static char* slot(lk_ring* ring, size_t index) {
+    return (char*)ring->data + ((ring->head + index) & (ring->capacity - 1)) * ring->memb_size;
+}
+
+lk_ring* lk_new_ring(size_t memb_size, size_t capacity) {
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    lk_ring* ring = lk_new(lk_ring);
+    if (!ring) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    ring->data      = NULL;
+    ring->memb_size = memb_size;
+    ring->capacity  = 0;
+    ring->head      = 0;
+    ring->size      = 0;
+
+    if (!lk_ring_reserve(ring, capacity)) {
+        lk_free_ring_internal(ring);
+        report_error(lk_last_error(), "lk_ring_reserve failed");
+        return NULL;
+    }
+
+    return ring;
+}
+
+void lk_free_ring_internal(lk_ring* ring) {
+    if (!ring) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    LK_FREE(ring->data);
+    LK_FREE(ring);
+}
+
+bool lk_ring_reserve(lk_ring* ring, size_t new_size) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return false;
+    }
+
+    if (new_size <= ring->capacity) {
+        return true;
+    }
+
+    size_t new_capacity = next_power_of_two(new_size);
+    if (new_capacity == 0) {
+        report_error(LK_ERR_INVALID_ARG, "new_size too large");
+        return false;
+    }
+
+    char* data = LK_REALLOCARRAY(ring->data, new_capacity, ring->memb_size);
+    if (!data) {
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return false;
+    }
+
+    // unwrap: the elements at [head, old capacity) are followed by the
+    // ones that wrapped around to [0, wrapped). Move whichever part is
+    // shorter, so they are contiguous modulo the new capacity again.
+    size_t old_capacity = ring->capacity;
+    size_t memb_size    = ring->memb_size;
+    if (ring->head + ring->size > old_capacity) {
+        size_t wrapped = ring->head + ring->size - old_capacity;
+        size_t front   = old_capacity - ring->head;
+        if (wrapped <= front) {
+            memcpy(data + old_capacity * memb_size, data, wrapped * memb_size);
+        } else {
+            size_t new_head = new_capacity - front;
+            memcpy(data + new_head * memb_size, data + ring->head * memb_size, front * memb_size);
+            ring->head = new_head;
+        }
+    }
+
+    ring->data     = data;
+    ring->capacity = new_capacity;
+
+    return true;
+}
+
+// Makes room for one more element.
+static bool grow(lk_ring* ring) {
+    if (ring->size < ring->capacity) {
+        return true;
+    }
+    if (ring->capacity > SIZE_MAX / 2) {
+        report_error(LK_ERR_INVALID_ARG, "ring too large");
+        return false;
+    }
+    return lk_ring_reserve(ring, ring->capacity ? ring->capacity * 2 : LK_DEFAULT_MIN_CAPACITY);
+}
+
+bool lk_ring_push_back(lk_ring* ring, void* buf) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return false;
+    }
+
+    if (!buf) {
+        report_error(LK_ERR_NULL, "buf cannot be NULL");
+        return false;
+    }
+
+    if (!grow(ring)) {
+        report_error(lk_last_error(), "grow failed");
+        return false;
+    }
+
+    memcpy(slot(ring, ring->size), buf, ring->memb_size);
+    ++ring->size;
+
+    return true;
+}
+
+bool lk_ring_push_front(lk_ring* ring, void* buf) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return false;
+    }
+
+    if (!buf) {
+        report_error(LK_ERR_NULL, "buf cannot be NULL");
+        return false;
+    }
+
+    if (!grow(ring)) {
+        report_error(lk_last_error(), "grow failed");
+        return false;
+    }
+
+    ring->head = (ring->head - 1) & (ring->capacity - 1);
+    memcpy(slot(ring, 0), buf, ring->memb_size);
+    ++ring->size;
+
+    return true;
+}
+
+bool lk_ring_pop_back(lk_ring* ring, void* out) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return false;
+    }
+
+    if (ring->size == 0) {
+        report_error(LK_ERR_EMPTY, "ring is empty");
+        return false;
+    }
+
+    --ring->size;
+    if (out) {
+        memcpy(out, slot(ring, ring->size), ring->memb_size);
+    }
+
+    return true;
+}
+
+bool lk_ring_pop_front(lk_ring* ring, void* out) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return false;
+    }
+
+    if (ring->size == 0) {
+        report_error(LK_ERR_EMPTY, "ring is empty");
+        return false;
+    }
+
+    if (out) {
+        memcpy(out, slot(ring, 0), ring->memb_size);
+    }
+    ring->head = (ring->head + 1) & (ring->capacity - 1);
+    --ring->size;
+
+    return true;
+}
+
+void* lk_ring_at_raw(lk_ring* ring, size_t index) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return NULL;
+    }
+
+    if (index >= ring->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return NULL;
+    }
+
+    return slot(ring, index);
+}
+
+lk_spsc_ring* lk_new_spsc_ring(size_t memb_size, size_t capacity) {
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    capacity = next_power_of_two(capacity ? capacity : 1);
+    if (capacity == 0) {
+        report_error(LK_ERR_INVALID_ARG, "capacity too large");
+        return NULL;
+    }
+
+    lk_spsc_ring* ring = lk_new(lk_spsc_ring);
+    if (!ring) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    ring->data = LK_REALLOCARRAY(NULL, capacity, memb_size);
+    if (!ring->data) {
+        LK_FREE(ring);
+        report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+        return NULL;
+    }
+
+    ring->memb_size   = memb_size;
+    ring->mask        = capacity - 1;
+    ring->cached_tail = 0;
+    ring->cached_head = 0;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return ring;
+}
+
+void lk_free_spsc_ring_internal(lk_spsc_ring* ring) {
+    if (!ring) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    LK_FREE(ring->data);
+    LK_FREE(ring);
+}
+
+bool lk_spsc_push(lk_spsc_ring* ring, const void* buf) {
+    if (!ring || !buf) {
+        report_error(LK_ERR_NULL, "ring and buf cannot be NULL");
+        return false;
+    }
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - ring->cached_head > ring->mask) {
+        // looks full, see how far the consumer got
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail - ring->cached_head > ring->mask) {
+            return false;
+        }
+    }
+
+    memcpy((char*)ring->data + (tail & ring->mask) * ring->memb_size, buf, ring->memb_size);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+bool lk_spsc_pop(lk_spsc_ring* ring, void* out) {
+    if (!ring || !out) {
+        report_error(LK_ERR_NULL, "ring and out cannot be NULL");
+        return false;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head == ring->cached_tail) {
+        // looks empty, see how far the producer got
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head == ring->cached_tail) {
+            return false;
+        }
+    }
+
+    memcpy(out, (char*)ring->data + (head & ring->mask) * ring->memb_size, ring->memb_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return true;
+}
+
+size_t lk_spsc_size(lk_spsc_ring* ring) {
+    if (!ring) {
+        report_error(LK_ERR_NULL, "ring cannot be NULL");
+        return 0;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+}
@@ -0,0 +1,134 @@
+#ifndef LK_RING_H
+#define LK_RING_H
+
+/*
+ * lk_ring.h
+ *
+ * Defines interface for handling
+ * - lk_ring, a double-ended queue in a circular buffer, which can be
+ *   pushed to and popped from at both ends in O(1), and
+ * - lk_spsc_ring, a fixed-size circular buffer which one producer thread
+ *   can push to while one consumer thread pops from it, without locks.
+ *
+ * Capacities are powers of two, so wrapping an index around is a mask.
+ * Growing an lk_ring reallocates the buffer and then moves the shorter of
+ * the two wrapped parts, instead of copying all elements into a new one.
+ *
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+#include <stdatomic.h>
+
+/// Size of a cache line, which lk_spsc_ring keeps the indices of the
+/// producer and the consumer apart by.
+#define LK_CACHE_LINE 64
+
+/// Structure that holds all data concerning a ring buffer.
+/// Element i (counted from the front) is at (head + i) & (capacity - 1).
+typedef struct {
+    void*  data;
+    size_t memb_size;
+    // power of two, or 0 if there is no data yet
+    size_t capacity;
+    size_t head;
+    size_t size;
+} lk_ring;
+
+/// Macro to use for freeing lk_rings. Sets ptr to NULL.
+#define lk_free_ring(ptr)           \
+    do {                            \
+        lk_free_ring_internal(ptr); \
+        ptr = NULL;                 \
+    } while (0)
+
+/// Allocates a new, empty ring buffer with room for at least capacity
+/// elements. capacity may be 0.
+/// The returned pointer may be NULL on error.
+lk_ring* lk_new_ring(size_t member_size, size_t capacity);
+
+/// Internal free() function. Use lk_free_ring instead.
+void lk_free_ring_internal(lk_ring* ring);
+
+/// Makes room for at least new_size elements. Only increases capacity.
+bool lk_ring_reserve(lk_ring* ring, size_t new_size);
+
+/// Appends the element pointed to by buf at the back.
+/// Only ring->memb_size bytes will be copied from buf.
+bool lk_ring_push_back(lk_ring* ring, void* buf);
+
+/// Prepends the element pointed to by buf at the front.
+/// Only ring->memb_size bytes will be copied from buf.
+bool lk_ring_push_front(lk_ring* ring, void* buf);
+
+/// Removes the last element, copying it to out if out isn't NULL.
+/// Fails with LK_ERR_EMPTY if ring is empty.
+bool lk_ring_pop_back(lk_ring* ring, void* out);
+
+/// Removes the first element, copying it to out if out isn't NULL.
+/// Fails with LK_ERR_EMPTY if ring is empty.
+bool lk_ring_pop_front(lk_ring* ring, void* out);
+
+/// Macro for simple access to values of specific type.
+/// Beware: returns NULL on failure.
+#define lk_ring_at(ring, type, index) \
+    (type*)lk_ring_at_raw(ring, index)
+
+/// Returns a void pointer to the element index places from the front.
+/// Returns NULL on failure (does bounds checking).
+void* lk_ring_at_raw(lk_ring* ring, size_t index);
+
+
+/// Structure that holds all data concerning a single-producer,
+/// single-consumer ring buffer. head and tail count all elements ever
+/// popped and pushed, and are only written by the consumer and the
+/// producer respectively. Each side keeps a copy of the other's index, so
+/// it only has to read the shared one when the ring looks full or empty.
+typedef struct {
+    void*  data;
+    size_t memb_size;
+    size_t mask;
+    char   pad0[LK_CACHE_LINE];
+    // consumer side
+    atomic_size_t head;
+    size_t        cached_tail;
+    char          pad1[LK_CACHE_LINE];
+    // producer side
+    atomic_size_t tail;
+    size_t        cached_head;
+    char          pad2[LK_CACHE_LINE];
+} lk_spsc_ring;
+
+/// Macro to use for freeing lk_spsc_rings. Sets ptr to NULL.
+#define lk_free_spsc_ring(ptr)           \
+    do {                                 \
+        lk_free_spsc_ring_internal(ptr); \
+        ptr = NULL;                      \
+    } while (0)
+
+/// Allocates a new, empty single-producer, single-consumer ring buffer
+/// holding up to capacity elements, rounded up to the next power of two.
+/// It never grows.
+/// The returned pointer may be NULL on error.
+lk_spsc_ring* lk_new_spsc_ring(size_t member_size, size_t capacity);
+
+/// Internal free() function. Use lk_free_spsc_ring instead.
+/// Neither thread may use the ring at this point.
+void lk_free_spsc_ring_internal(lk_spsc_ring* ring);
+
+/// Appends the element pointed to by buf. Only call this from the
+/// producer thread. Returns false if the ring is full; this is not
+/// reported as an error.
+bool lk_spsc_push(lk_spsc_ring* ring, const void* buf);
+
+/// Removes the first element and copies it to out. Only call this from
+/// the consumer thread. Returns false if the ring is empty; this is not
+/// reported as an error.
+bool lk_spsc_pop(lk_spsc_ring* ring, void* out);
+
+/// Returns the number of elements in the ring. Exact only when called from
+/// the producer or the consumer while the other side is idle.
+size_t lk_spsc_size(lk_spsc_ring* ring);
+
+#endif // LK_RING_H
@@ -0,0 +1,197 @@
+#include "lk_segmented.h"
+#include <string.h>
+#include <stdint.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+lk_segmented_array* lk_new_segmented_array(size_t size, size_t memb_size, size_t chunk_size) {
+    if (memb_size == 0) {
+        report_error(LK_ERR_INVALID_ARG, "memb_size may never be 0");
+        return NULL;
+    }
+
+    if (chunk_size == 0) {
+        chunk_size = LK_SEGMENTED_DEFAULT_CHUNK_SIZE;
+    }
+
+    size_t shift = 0;
+    while (((size_t)1 << shift) < chunk_size) {
+        if (shift == sizeof(size_t) * 8 - 2) {
+            report_error(LK_ERR_INVALID_ARG, "chunk_size too large");
+            return NULL;
+        }
+        ++shift;
+    }
+
+    lk_segmented_array* arr = lk_new(lk_segmented_array);
+    if (!arr) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    arr->chunks             = NULL;
+    arr->chunk_count        = 0;
+    arr->directory_capacity = 0;
+    arr->chunk_shift        = shift;
+    arr->memb_size          = memb_size;
+    arr->size               = 0;
+
+    if (!lk_segmented_resize(arr, size)) {
+        lk_free_segmented_array_internal(arr);
+        report_error(lk_last_error(), "lk_segmented_resize failed");
+        return NULL;
+    }
+
+    return arr;
+}
+
+void lk_free_segmented_array_internal(lk_segmented_array* arr) {
+    if (!arr) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    for (size_t i = 0; i < arr->chunk_count; ++i) {
+        LK_FREE(arr->chunks[i]);
+    }
+    LK_FREE(arr->chunks);
+    LK_FREE(arr);
+}
+
+size_t lk_segmented_capacity(lk_segmented_array* arr) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return 0;
+    }
+
+    return arr->chunk_count << arr->chunk_shift;
+}
+
+bool lk_segmented_reserve(lk_segmented_array* arr, size_t new_size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (new_size < arr->size) {
+        report_error(LK_ERR_INVALID_ARG, "cannot reserve less than is already used by arr");
+        return false;
+    }
+
+    size_t chunk_size = (size_t)1 << arr->chunk_shift;
+    size_t needed     = (new_size >> arr->chunk_shift) + ((new_size & (chunk_size - 1)) != 0);
+    if (needed <= arr->chunk_count) {
+        return true;
+    }
+
+    if (needed > arr->directory_capacity) {
+        // only the directory is reallocated, the chunks stay where they are
+        size_t new_capacity = arr->directory_capacity * 2;
+        if (new_capacity < needed) {
+            new_capacity = needed;
+        }
+        void** new_chunks = LK_REALLOCARRAY(arr->chunks, new_capacity, sizeof(void*));
+        if (!new_chunks) {
+            report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+            return false;
+        }
+        arr->chunks             = new_chunks;
+        arr->directory_capacity = new_capacity;
+    }
+
+    while (arr->chunk_count < needed) {
+        void* chunk = LK_CALLOC(chunk_size, arr->memb_size);
+        if (!chunk) {
+            report_error(LK_ERR_ALLOC, "LK_CALLOC failed");
+            return false;
+        }
+        arr->chunks[arr->chunk_count++] = chunk;
+    }
+
+    return true;
+}
+
+bool lk_segmented_resize(lk_segmented_array* arr, size_t new_size) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (new_size <= arr->size) {
+        arr->size = new_size;
+        return true;
+    }
+
+    size_t old_capacity = arr->chunk_count << arr->chunk_shift;
+    if (!lk_segmented_reserve(arr, new_size)) {
+        report_error(lk_last_error(), "lk_segmented_reserve failed");
+        return false;
+    }
+
+    // new chunks are zeroed when allocated, only the old ones might hold
+    // elements left over from shrinking
+    size_t chunk_size = (size_t)1 << arr->chunk_shift;
+    size_t end        = new_size < old_capacity ? new_size : old_capacity;
+    for (size_t i = arr->size; i < end;) {
+        size_t offset = i & (chunk_size - 1);
+        size_t count  = chunk_size - offset < end - i ? chunk_size - offset : end - i;
+        memset((char*)arr->chunks[i >> arr->chunk_shift] + offset * arr->memb_size, 0, count * arr->memb_size);
+        i += count;
+    }
+    arr->size = new_size;
+
+    return true;
+}
+
+bool lk_segmented_push_back(lk_segmented_array* arr, void* buf) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    if (!buf) {
+        report_error(LK_ERR_NULL, "buf cannot be NULL");
+        return false;
+    }
+
+    if (arr->size == arr->chunk_count << arr->chunk_shift
+        && !lk_segmented_reserve(arr, arr->size + 1)) {
+        report_error(lk_last_error(), "lk_segmented_reserve failed");
+        return false;
+    }
+
+    ++arr->size;
+    memcpy(lk_segmented_at_raw_unchecked(arr, arr->size - 1), buf, arr->memb_size);
+
+    return true;
+}
+
+void* lk_segmented_at_raw(lk_segmented_array* arr, size_t index) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return NULL;
+    }
+
+    if (index >= arr->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return NULL;
+    }
+
+    return lk_segmented_at_raw_unchecked(arr, index);
+}
+
+bool lk_segmented_set(lk_segmented_array* arr, size_t index, void* value) {
+    void* at = lk_segmented_at_raw(arr, index);
+    if (!at) {
+        report_error(lk_last_error(), "lk_segmented_at_raw failed");
+        return false;
+    }
+
+    if (!value) {
+        report_error(LK_ERR_NULL, "value cannot be NULL");
+        return false;
+    }
+
+    memcpy(at, value, arr->memb_size);
+
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef LK_SEGMENTED_H
+#define LK_SEGMENTED_H
+
+/*
+ * lk_segmented.h
+ *
+ * Defines interface for handling the lk_segmented_array structure, a
+ * dynamic array stored in fixed-size chunks instead of one buffer.
+ *
+ * Growing never moves existing elements, so pointers returned by
+ * lk_segmented_at stay valid until the element is removed, and growing
+ * a huge array doesn't copy it or need twice its memory.
+ * Chunks hold a power of two of elements, so indexing is a shift and a mask.
+ *
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+/// Default number of elements per chunk.
+#ifndef LK_SEGMENTED_DEFAULT_CHUNK_SIZE
+#define LK_SEGMENTED_DEFAULT_CHUNK_SIZE 1024
+#endif // LK_SEGMENTED_DEFAULT_CHUNK_SIZE
+
+/// Structure that holds all data concerning a segmented array.
+typedef struct {
+    // chunk directory, chunk_count chunks of (1 << chunk_shift) elements each
+    void** chunks;
+    size_t chunk_count;
+    size_t directory_capacity;
+    size_t chunk_shift;
+    size_t memb_size;
+    size_t size;
+} lk_segmented_array;
+
+/// Macro to use for freeing lk_segmented_arrays. Sets ptr to NULL.
+#define lk_free_segmented_array(ptr)           \
+    do {                                       \
+        lk_free_segmented_array_internal(ptr); \
+        ptr = NULL;                            \
+    } while (0)
+
+/// Allocates a new segmented array with size zeroed elements.
+/// chunk_size is the number of elements per chunk, and is rounded up to
+/// the next power of two. If it's 0, LK_SEGMENTED_DEFAULT_CHUNK_SIZE is used.
+/// The returned pointer may be NULL on error.
+/// The returned pointer, if not NULL, has to be free'd using lk_free_segmented_array.
+lk_segmented_array* lk_new_segmented_array(size_t size, size_t member_size, size_t chunk_size);
+
+/// Internal free() function. Use lk_free_segmented_array instead.
+void lk_free_segmented_array_internal(lk_segmented_array* arr);
+
+/// Returns the number of elements arr can hold without allocating.
+size_t lk_segmented_capacity(lk_segmented_array* arr);
+
+/// Pushes back (appends) the element pointed to by buf.
+/// Only arr->memb_size bytes will be copied from buf.
+/// Never moves existing elements.
+/// Returns false on error, true on success.
+bool lk_segmented_push_back(lk_segmented_array* arr, void* buf);
+
+/// Allocates enough chunks to hold new_size elements.
+/// Will fail if new_size < arr->size.
+bool lk_segmented_reserve(lk_segmented_array* arr, size_t new_size);
+
+/// Resizes the array to hold new_size elements. New elements are zeroed.
+/// Shrinking does not free any chunks.
+bool lk_segmented_resize(lk_segmented_array* arr, size_t new_size);
+
+/// Macro for simple access to values of specific type.
+/// Beware: returns NULL on failure.
+#define lk_segmented_at(arr, type, index) \
+    (type*)lk_segmented_at_raw(arr, index)
+
+/// Returns a void pointer to the specified index in the array.
+/// Returns NULL on failure (does bounds checking).
+void* lk_segmented_at_raw(lk_segmented_array* arr, size_t index);
+
+/// Sets the value at the given index in the array.
+/// Does bounds checking, returns false on failure.
+bool lk_segmented_set(lk_segmented_array* arr, size_t index, void* value);
+
+/// Unchecked version of lk_segmented_at_raw, see lk_at_raw_unchecked.
+static inline void* lk_segmented_at_raw_unchecked(lk_segmented_array* arr, size_t index) {
+    assert(arr && index < arr->size);
+    size_t mask = ((size_t)1 << arr->chunk_shift) - 1;
+    return (char*)arr->chunks[index >> arr->chunk_shift] + (index & mask) * arr->memb_size;
+}
+
+#endif // LK_SEGMENTED_H
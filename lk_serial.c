@@ -0,0 +1,366 @@
+#include "lk_serial.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+#define HEADER_SIZE sizeof(lk_serial_header)
+
+_Static_assert(sizeof(lk_serial_header) == LK_SERIAL_DEFAULT_ALIGNMENT, "lk_serial_header has to fill the default alignment");
+
+// The multiplication and rotation round of xxHash64, on four independent
+// lanes of 8 bytes each, so the loop isn't bound by a single dependency
+// chain. Not compatible with xxHash64 itself.
+#define PRIME_1 0x9e3779b185ebca87ull
+#define PRIME_2 0xc2b2ae3d27d4eb4full
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t round_lane(uint64_t lane, uint64_t word) {
+    return rotl(lane + word * PRIME_2, 31) * PRIME_1;
+}
+
+static uint64_t load_u64(const unsigned char* p) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+static uint64_t checksum(const void* data, size_t bytes) {
+    const unsigned char* p        = data;
+    uint64_t             lanes[4] = { PRIME_1 + PRIME_2, PRIME_2, 0, -PRIME_1 };
+    size_t               i        = 0;
+
+    for (; i + 32 <= bytes; i += 32) {
+        lanes[0] = round_lane(lanes[0], load_u64(p + i));
+        lanes[1] = round_lane(lanes[1], load_u64(p + i + 8));
+        lanes[2] = round_lane(lanes[2], load_u64(p + i + 16));
+        lanes[3] = round_lane(lanes[3], load_u64(p + i + 24));
+    }
+
+    uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) + bytes;
+    for (; i + 8 <= bytes; i += 8) {
+        hash = rotl(hash ^ round_lane(0, load_u64(p + i)), 27) * PRIME_1;
+    }
+    for (; i < bytes; ++i) {
+        hash = rotl(hash ^ (p[i] * PRIME_1), 11) * PRIME_2;
+    }
+
+    // final avalanche, so every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Either an fd or a FILE, so both share the code below.
+struct stream {
+    int   fd;
+    FILE* file;
+};
+
+static bool write_all(struct stream* s, const void* data, size_t bytes) {
+    if (s->file) {
+        return fwrite(data, 1, bytes, s->file) == bytes;
+    }
+
+    const char* p = data;
+    while (bytes > 0) {
+        ssize_t n = write(s->fd, p, bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+// Reads exactly bytes bytes. data may be NULL to skip them.
+static bool read_all(struct stream* s, void* data, size_t bytes) {
+    char  skip[256];
+    char* p = data;
+    while (bytes > 0) {
+        char*   dst  = p ? p : skip;
+        size_t  want = p || bytes < sizeof(skip) ? bytes : sizeof(skip);
+        ssize_t n;
+        if (s->file) {
+            n = (ssize_t)fread(dst, 1, want, s->file);
+        } else {
+            n = read(s->fd, dst, want);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+        }
+        if (n <= 0) {
+            return false;
+        }
+        if (p) {
+            p += n;
+        }
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+static bool write_stream(lk_array* arr, struct stream* s, size_t alignment) {
+    if (alignment == 0) {
+        alignment = LK_SERIAL_DEFAULT_ALIGNMENT;
+    }
+
+    if (alignment < LK_SERIAL_DEFAULT_ALIGNMENT || (alignment & (alignment - 1)) != 0) {
+        report_error(LK_ERR_INVALID_ARG, "alignment has to be a power of two of at least LK_SERIAL_DEFAULT_ALIGNMENT");
+        return false;
+    }
+
+    size_t           bytes = arr->size * arr->memb_size;
+    lk_serial_header header;
+    memset(&header, 0, HEADER_SIZE);
+    memcpy(header.magic, LK_SERIAL_MAGIC, sizeof(header.magic));
+    header.version    = LK_SERIAL_VERSION;
+    header.byte_order = LK_SERIAL_BYTE_ORDER;
+    header.memb_size  = arr->memb_size;
+    header.size       = arr->size;
+    header.alignment  = alignment;
+    header.checksum   = checksum(arr->data, bytes);
+
+    if (!write_all(s, &header, HEADER_SIZE)) {
+        report_error(LK_ERR_INVALID_ARG, "writing the header failed");
+        return false;
+    }
+
+    static const char zeroes[256] = { 0 };
+    for (size_t padding = alignment - HEADER_SIZE; padding > 0;) {
+        size_t n = padding < sizeof(zeroes) ? padding : sizeof(zeroes);
+        if (!write_all(s, zeroes, n)) {
+            report_error(LK_ERR_INVALID_ARG, "writing the padding failed");
+            return false;
+        }
+        padding -= n;
+    }
+
+    if (bytes > 0 && !write_all(s, arr->data, bytes)) {
+        report_error(LK_ERR_INVALID_ARG, "writing the elements failed");
+        return false;
+    }
+
+    return true;
+}
+
+bool lk_serial_write_fd(lk_array* arr, int fd, size_t alignment) {
+    if (!arr) {
+        report_error(LK_ERR_NULL, "arr cannot be NULL");
+        return false;
+    }
+
+    struct stream s = { fd, NULL };
+    return write_stream(arr, &s, alignment);
+}
+
+bool lk_serial_write_file(lk_array* arr, FILE* file, size_t alignment) {
+    if (!arr || !file) {
+        report_error(LK_ERR_NULL, "arr and file cannot be NULL");
+        return false;
+    }
+
+    struct stream s = { -1, file };
+    return write_stream(arr, &s, alignment);
+}
+
+// Checks everything in header but the checksum, and stores the number of
+// bytes of the elements in bytes.
+static bool check_header(const lk_serial_header* header, size_t* bytes) {
+    if (memcmp(header->magic, LK_SERIAL_MAGIC, sizeof(header->magic)) != 0) {
+        report_error(LK_ERR_INVALID_ARG, "not a serialized lk_array");
+        return false;
+    }
+
+    if (header->byte_order != LK_SERIAL_BYTE_ORDER) {
+        report_error(LK_ERR_INVALID_ARG, "serialized with a different byte order");
+        return false;
+    }
+
+    if (header->version != LK_SERIAL_VERSION) {
+        report_error(LK_ERR_INVALID_ARG, "unsupported version");
+        return false;
+    }
+
+    if (header->memb_size == 0 || header->memb_size > SIZE_MAX || header->size > SIZE_MAX / header->memb_size) {
+        report_error(LK_ERR_INVALID_ARG, "invalid memb_size or size");
+        return false;
+    }
+
+    uint64_t alignment = header->alignment;
+    if (alignment < HEADER_SIZE || (alignment & (alignment - 1)) != 0 || alignment > SIZE_MAX) {
+        report_error(LK_ERR_INVALID_ARG, "invalid alignment");
+        return false;
+    }
+
+    *bytes = (size_t)(header->size * header->memb_size);
+    return true;
+}
+
+static lk_array* read_stream(struct stream* s) {
+    lk_serial_header header;
+    size_t           bytes;
+    if (!read_all(s, &header, HEADER_SIZE)) {
+        report_error(LK_ERR_INVALID_ARG, "reading the header failed");
+        return NULL;
+    }
+    if (!check_header(&header, &bytes)) {
+        return NULL;
+    }
+
+    if (!read_all(s, NULL, (size_t)header.alignment - HEADER_SIZE)) {
+        report_error(LK_ERR_INVALID_ARG, "reading the padding failed");
+        return NULL;
+    }
+
+    // every element is overwritten right away
+    lk_array* arr = lk_new_array_uninit((size_t)header.size, (size_t)header.memb_size);
+    if (!arr) {
+        report_error(lk_last_error(), "lk_new_array_uninit failed");
+        return NULL;
+    }
+
+    if (bytes > 0 && !read_all(s, arr->data, bytes)) {
+        lk_free_array(arr);
+        report_error(LK_ERR_INVALID_ARG, "reading the elements failed");
+        return NULL;
+    }
+
+    if (checksum(arr->data, bytes) != header.checksum) {
+        lk_free_array(arr);
+        report_error(LK_ERR_INVALID_ARG, "checksum mismatch");
+        return NULL;
+    }
+
+    return arr;
+}
+
+lk_array* lk_serial_read_fd(int fd) {
+    struct stream s = { fd, NULL };
+    return read_stream(&s);
+}
+
+lk_array* lk_serial_read_file(FILE* file) {
+    if (!file) {
+        report_error(LK_ERR_NULL, "file cannot be NULL");
+        return NULL;
+    }
+
+    struct stream s = { -1, file };
+    return read_stream(&s);
+}
+
+bool lk_serial_view(const void* buffer, size_t bytes, bool verify, lk_array_view* view) {
+    if (!buffer || !view) {
+        report_error(LK_ERR_NULL, "buffer and view cannot be NULL");
+        return false;
+    }
+
+    if (bytes < HEADER_SIZE) {
+        report_error(LK_ERR_INVALID_ARG, "buffer too small");
+        return false;
+    }
+
+    // the buffer may not be aligned for the header
+    lk_serial_header header;
+    size_t           data_bytes;
+    memcpy(&header, buffer, HEADER_SIZE);
+    if (!check_header(&header, &data_bytes)) {
+        return false;
+    }
+
+    if ((size_t)header.alignment > bytes || data_bytes > bytes - (size_t)header.alignment) {
+        report_error(LK_ERR_INVALID_ARG, "buffer too small");
+        return false;
+    }
+
+    const char* data = (const char*)buffer + header.alignment;
+    // largest power of two dividing memb_size, up to 16
+    size_t memb_align = (size_t)header.memb_size & -(size_t)header.memb_size;
+    memb_align        = memb_align < 16 ? memb_align : 16;
+    if ((uintptr_t)data % memb_align != 0) {
+        report_error(LK_ERR_INVALID_ARG, "elements are misaligned");
+        return false;
+    }
+
+    if (verify && checksum(data, data_bytes) != header.checksum) {
+        report_error(LK_ERR_INVALID_ARG, "checksum mismatch");
+        return false;
+    }
+
+    view->data      = (void*)data;
+    view->memb_size = (size_t)header.memb_size;
+    view->size      = (size_t)header.size;
+
+    return true;
+}
+
+lk_serial_mapping* lk_serial_map(const char* path, bool verify) {
+    if (!path) {
+        report_error(LK_ERR_NULL, "path cannot be NULL");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        report_error(LK_ERR_INVALID_ARG, "open failed");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE) {
+        close(fd);
+        report_error(LK_ERR_INVALID_ARG, "file too small");
+        return NULL;
+    }
+
+    // the mapping stays valid after closing the fd
+    size_t map_size = (size_t)st.st_size;
+    void*  map      = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        report_error(LK_ERR_ALLOC, "mmap failed");
+        return NULL;
+    }
+
+    lk_serial_mapping* mapping = lk_new(lk_serial_mapping);
+    if (!mapping) {
+        munmap(map, map_size);
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    mapping->map      = map;
+    mapping->map_size = map_size;
+    if (!lk_serial_view(map, map_size, verify, &mapping->view)) {
+        lk_serial_unmap(mapping);
+        report_error(lk_last_error(), "lk_serial_view failed");
+        return NULL;
+    }
+
+    return mapping;
+}
+
+void lk_serial_unmap_internal(lk_serial_mapping* mapping) {
+    if (!mapping) {
+        // unmapping a NULL ptr is okay, no error
+        return;
+    }
+
+    munmap(mapping->map, mapping->map_size);
+    LK_FREE(mapping);
+}
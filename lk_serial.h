@@ -0,0 +1,105 @@
+#ifndef LK_SERIAL_H
+#define LK_SERIAL_H
+
+/*
+ * lk_serial.h
+ *
+ * Defines interface for saving and loading lk_arrays in a versioned
+ * binary format.
+ *
+ * A serialized array is an lk_serial_header, zero padding up to the
+ * alignment given when writing, and then the elements, exactly as they are
+ * in memory. It is written straight from the array's data, without
+ * copying it into a buffer first.
+ *
+ * It can be loaded in two ways:
+ * - by reading it into a new lk_array (lk_serial_read_fd,
+ *   lk_serial_read_file), or
+ * - without copying, as a read-only lk_array_view into a buffer that holds
+ *   the whole of it (lk_serial_view) or into a mapping of a file
+ *   (lk_serial_map). Only the pages that are touched get loaded.
+ *
+ * The elements are not converted in any way, so a file can only be loaded
+ * on a machine with the same byte order, which is checked.
+ *
+ * POSIX only. Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LK_SERIAL_MAGIC "LKSERIAL"
+#define LK_SERIAL_VERSION 1
+
+/// Written in the byte order of the machine that wrote the file.
+#define LK_SERIAL_BYTE_ORDER 0x01020304u
+
+/// Alignment used when 0 is passed. Also the size of lk_serial_header.
+#define LK_SERIAL_DEFAULT_ALIGNMENT 64
+
+/// Header at the start of a serialized array. All fields are in the byte
+/// order of the machine that wrote it.
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    // LK_SERIAL_BYTE_ORDER
+    uint32_t byte_order;
+    uint64_t memb_size;
+    uint64_t size;
+    // offset of the elements from the start of the header
+    uint64_t alignment;
+    // checksum of the elements
+    uint64_t checksum;
+    uint8_t  reserved[16];
+} lk_serial_header;
+
+/// A serialized array mapped from a file, see lk_serial_map.
+typedef struct {
+    void*         map;
+    size_t        map_size;
+    lk_array_view view;
+} lk_serial_mapping;
+
+/// Macro to use for unmapping lk_serial_mappings. Sets ptr to NULL.
+#define lk_serial_unmap(ptr)           \
+    do {                               \
+        lk_serial_unmap_internal(ptr); \
+        ptr = NULL;                    \
+    } while (0)
+
+/// Writes arr to fd. The elements start at a multiple of alignment bytes
+/// from the start of the header, which has to be a power of two of at
+/// least LK_SERIAL_DEFAULT_ALIGNMENT, or 0 for that.
+/// Use the page size to be able to map the elements of a file in place.
+bool lk_serial_write_fd(lk_array* arr, int fd, size_t alignment);
+
+/// Like lk_serial_write_fd, but writes to file.
+bool lk_serial_write_file(lk_array* arr, FILE* file, size_t alignment);
+
+/// Reads a serialized array from fd into a new lk_array, and checks its
+/// checksum. fd is left after the last element.
+/// The returned pointer may be NULL on error.
+lk_array* lk_serial_read_fd(int fd);
+
+/// Like lk_serial_read_fd, but reads from file.
+lk_array* lk_serial_read_file(FILE* file);
+
+/// Makes view point at the elements of the serialized array in the bytes
+/// bytes at buffer, without copying. The elements have to be aligned in
+/// memory to the largest power of two that divides memb_size, up to 16.
+/// If verify is true, the checksum is checked, which reads all of them.
+/// The view is read-only, and valid as long as buffer is.
+bool lk_serial_view(const void* buffer, size_t bytes, bool verify, lk_array_view* view);
+
+/// Maps the file at path, which has to hold a serialized array, read-only
+/// and makes the view of the returned mapping point at its elements.
+/// See lk_serial_view for verify.
+/// The returned pointer may be NULL on error.
+lk_serial_mapping* lk_serial_map(const char* path, bool verify);
+
+/// Internal unmap function. Use lk_serial_unmap instead.
+void lk_serial_unmap_internal(lk_serial_mapping* mapping);
+
+#endif // LK_SERIAL_H
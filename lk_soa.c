@@ -0,0 +1,273 @@
+#include "lk_soa.h"
+#include <string.h>
+#include <stdint.h>
+
+#define report_error(code, str) lk_report_error_internal(code, __FUNCTION__, str)
+
+lk_soa* lk_new_soa(size_t field_count, const size_t* field_sizes, const size_t* field_offsets, size_t record_size) {
+    if (field_count == 0 || !field_sizes) {
+        report_error(LK_ERR_INVALID_ARG, "a record needs at least one field");
+        return NULL;
+    }
+
+    // check the layout before allocating anything
+    size_t end = 0;
+    for (size_t i = 0; i < field_count; ++i) {
+        size_t offset = field_offsets ? field_offsets[i] : end;
+        if (field_sizes[i] == 0 || offset > SIZE_MAX - field_sizes[i]) {
+            report_error(LK_ERR_INVALID_ARG, "invalid field size");
+            return NULL;
+        }
+        if (!field_offsets || offset + field_sizes[i] > end) {
+            end = offset + field_sizes[i];
+        }
+    }
+    if (record_size == 0) {
+        record_size = end;
+    }
+    if (end > record_size) {
+        report_error(LK_ERR_INVALID_ARG, "fields reach past record_size");
+        return NULL;
+    }
+    if (field_offsets) {
+        for (size_t i = 0; i < field_count; ++i) {
+            for (size_t j = i + 1; j < field_count; ++j) {
+                if (field_offsets[i] < field_offsets[j] + field_sizes[j]
+                    && field_offsets[j] < field_offsets[i] + field_sizes[i]) {
+                    report_error(LK_ERR_INVALID_ARG, "fields overlap");
+                    return NULL;
+                }
+            }
+        }
+    }
+
+    lk_soa* soa = lk_new(lk_soa);
+    if (!soa) {
+        report_error(LK_ERR_ALLOC, "LK_MALLOC failed");
+        return NULL;
+    }
+
+    soa->columns       = LK_CALLOC(field_count, sizeof(void*));
+    soa->field_sizes   = LK_REALLOCARRAY(NULL, field_count, sizeof(size_t));
+    soa->field_offsets = LK_REALLOCARRAY(NULL, field_count, sizeof(size_t));
+    soa->field_count   = field_count;
+    soa->record_size   = record_size;
+    soa->size          = 0;
+    soa->capacity      = 0;
+    if (!soa->columns || !soa->field_sizes || !soa->field_offsets) {
+        lk_free_soa_internal(soa);
+        report_error(LK_ERR_ALLOC, "allocation of field descriptions failed");
+        return NULL;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < field_count; ++i) {
+        soa->field_sizes[i]   = field_sizes[i];
+        soa->field_offsets[i] = field_offsets ? field_offsets[i] : offset;
+        offset += field_sizes[i];
+    }
+
+    return soa;
+}
+
+void lk_free_soa_internal(lk_soa* soa) {
+    if (!soa) {
+        // freeing a NULL ptr is okay, no error
+        return;
+    }
+    if (soa->columns) {
+        for (size_t i = 0; i < soa->field_count; ++i) {
+            LK_FREE(soa->columns[i]);
+        }
+    }
+    LK_FREE(soa->columns);
+    LK_FREE(soa->field_sizes);
+    LK_FREE(soa->field_offsets);
+    LK_FREE(soa);
+}
+
+bool lk_soa_reserve(lk_soa* soa, size_t new_size) {
+    if (!soa) {
+        report_error(LK_ERR_NULL, "soa cannot be NULL");
+        return false;
+    }
+
+    if (new_size <= soa->capacity) {
+        return true;
+    }
+
+    // if a later column fails, the earlier ones just have spare room
+    for (size_t i = 0; i < soa->field_count; ++i) {
+        void* column = LK_REALLOCARRAY(soa->columns[i], new_size, soa->field_sizes[i]);
+        if (!column) {
+            report_error(LK_ERR_ALLOC, "LK_REALLOCARRAY failed");
+            return false;
+        }
+        soa->columns[i] = column;
+    }
+    soa->capacity = new_size;
+
+    return true;
+}
+
+// Makes room for count more records, growing geometrically.
+static bool grow(lk_soa* soa, size_t count) {
+    if (count > SIZE_MAX - soa->size) {
+        report_error(LK_ERR_INVALID_ARG, "count too large");
+        return false;
+    }
+
+    size_t needed = soa->size + count;
+    if (needed <= soa->capacity) {
+        return true;
+    }
+
+    size_t new_capacity = soa->capacity < SIZE_MAX / 2 ? soa->capacity * 2 : needed;
+    if (new_capacity < needed) {
+        new_capacity = needed;
+    }
+    if (new_capacity < LK_DEFAULT_MIN_CAPACITY) {
+        new_capacity = LK_DEFAULT_MIN_CAPACITY;
+    }
+
+    return lk_soa_reserve(soa, new_capacity);
+}
+
+// Scatters count records from records into the columns, starting at index.
+static void scatter(lk_soa* soa, size_t index, const char* records, size_t count) {
+    for (size_t f = 0; f < soa->field_count; ++f) {
+        size_t      field_size = soa->field_sizes[f];
+        char*       dst        = (char*)soa->columns[f] + index * field_size;
+        const char* src        = records + soa->field_offsets[f];
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(dst + i * field_size, src + i * soa->record_size, field_size);
+        }
+    }
+}
+
+// Gathers count records starting at index from the columns into out.
+static void gather(lk_soa* soa, size_t index, char* out, size_t count) {
+    for (size_t f = 0; f < soa->field_count; ++f) {
+        size_t      field_size = soa->field_sizes[f];
+        const char* src        = (const char*)soa->columns[f] + index * field_size;
+        char*       dst        = out + soa->field_offsets[f];
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(dst + i * soa->record_size, src + i * field_size, field_size);
+        }
+    }
+}
+
+bool lk_soa_resize(lk_soa* soa, size_t new_size) {
+    if (!soa) {
+        report_error(LK_ERR_NULL, "soa cannot be NULL");
+        return false;
+    }
+
+    if (new_size > soa->size) {
+        if (!lk_soa_reserve(soa, new_size)) {
+            report_error(lk_last_error(), "lk_soa_reserve failed");
+            return false;
+        }
+        for (size_t f = 0; f < soa->field_count; ++f) {
+            size_t field_size = soa->field_sizes[f];
+            memset((char*)soa->columns[f] + soa->size * field_size, 0, (new_size - soa->size) * field_size);
+        }
+    }
+    soa->size = new_size;
+
+    return true;
+}
+
+bool lk_soa_push_back(lk_soa* soa, const void* record) {
+    return lk_soa_append_records(soa, record, 1);
+}
+
+bool lk_soa_append_records(lk_soa* soa, const void* records, size_t count) {
+    if (!soa) {
+        report_error(LK_ERR_NULL, "soa cannot be NULL");
+        return false;
+    }
+
+    if (count == 0) {
+        return true;
+    }
+
+    if (!records) {
+        report_error(LK_ERR_NULL, "records cannot be NULL");
+        return false;
+    }
+
+    if (!grow(soa, count)) {
+        report_error(lk_last_error(), "grow failed");
+        return false;
+    }
+
+    scatter(soa, soa->size, records, count);
+    soa->size += count;
+
+    return true;
+}
+
+bool lk_soa_set(lk_soa* soa, size_t index, const void* record) {
+    if (!soa || !record) {
+        report_error(LK_ERR_NULL, "soa and record cannot be NULL");
+        return false;
+    }
+
+    if (index >= soa->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "index out of bounds");
+        return false;
+    }
+
+    scatter(soa, index, record, 1);
+
+    return true;
+}
+
+bool lk_soa_get(lk_soa* soa, size_t index, void* out) {
+    return lk_soa_get_records(soa, index, 1, out);
+}
+
+bool lk_soa_get_records(lk_soa* soa, size_t index, size_t count, void* out) {
+    if (!soa || !out) {
+        report_error(LK_ERR_NULL, "soa and out cannot be NULL");
+        return false;
+    }
+
+    if (index > soa->size || count > soa->size - index) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "range out of bounds");
+        return false;
+    }
+
+    gather(soa, index, out, count);
+
+    return true;
+}
+
+void* lk_soa_column_raw(lk_soa* soa, size_t field) {
+    if (!soa) {
+        report_error(LK_ERR_NULL, "soa cannot be NULL");
+        return NULL;
+    }
+
+    if (field >= soa->field_count) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "field out of bounds");
+        return NULL;
+    }
+
+    return soa->columns[field];
+}
+
+void* lk_soa_field_at(lk_soa* soa, size_t field, size_t index) {
+    if (!soa) {
+        report_error(LK_ERR_NULL, "soa cannot be NULL");
+        return NULL;
+    }
+
+    if (field >= soa->field_count || index >= soa->size) {
+        report_error(LK_ERR_OUT_OF_BOUNDS, "field or index out of bounds");
+        return NULL;
+    }
+
+    return (char*)soa->columns[field] + index * soa->field_sizes[field];
+}
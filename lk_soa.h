@@ -0,0 +1,90 @@
+#ifndef LK_SOA_H
+#define LK_SOA_H
+
+/*
+ * lk_soa.h
+ *
+ * Defines interface for handling the lk_soa structure, a struct-of-arrays
+ * container: records are split into their fields, and each field is
+ * stored in its own contiguous column. A scan over one field only reads
+ * that field's column, instead of pulling whole records through the cache.
+ *
+ * Records are passed in and out in array-of-structs form, as described
+ * by the size and offset of every field in the record. They are
+ * scattered into the columns on the way in and gathered on the way out.
+ *
+ * Error handling is the same as for lk_array (see lk_array.h).
+ */
+
+#include "lk_array.h"
+
+/// Structure that holds all data concerning a struct-of-arrays container.
+/// Column i holds capacity elements of field_sizes[i] bytes each.
+typedef struct {
+    void**  columns;
+    size_t* field_sizes;
+    // offset of each field in a record
+    size_t* field_offsets;
+    size_t  field_count;
+    size_t  record_size;
+    size_t  size;
+    size_t  capacity;
+} lk_soa;
+
+/// Macro to use for freeing lk_soas. Sets ptr to NULL.
+#define lk_free_soa(ptr)           \
+    do {                           \
+        lk_free_soa_internal(ptr); \
+        ptr = NULL;                \
+    } while (0)
+
+/// Allocates a new, empty lk_soa for records of field_count fields.
+/// field_offsets gives the offset of every field in a record and may be
+/// NULL, in which case the fields are packed in order. record_size is the
+/// size of a record, such as sizeof of a struct, or 0 for the end of the
+/// last field. Fields may not overlap or reach past record_size.
+/// The returned pointer may be NULL on error.
+lk_soa* lk_new_soa(size_t field_count, const size_t* field_sizes, const size_t* field_offsets, size_t record_size);
+
+/// Internal free() function. Use lk_free_soa instead.
+void lk_free_soa_internal(lk_soa* soa);
+
+/// Makes room for new_size records in every column. Only increases capacity.
+bool lk_soa_reserve(lk_soa* soa, size_t new_size);
+
+/// Resizes soa to new_size records. New records are zeroed.
+bool lk_soa_resize(lk_soa* soa, size_t new_size);
+
+/// Appends the record pointed to by record, scattering its fields into
+/// the columns.
+bool lk_soa_push_back(lk_soa* soa, const void* record);
+
+/// Appends count records from the array of records at records.
+bool lk_soa_append_records(lk_soa* soa, const void* records, size_t count);
+
+/// Overwrites the record at index with the one pointed to by record.
+bool lk_soa_set(lk_soa* soa, size_t index, const void* record);
+
+/// Gathers the record at index into out. Bytes of out that belong to no
+/// field are left alone.
+bool lk_soa_get(lk_soa* soa, size_t index, void* out);
+
+/// Gathers count records starting at index into the array of records at
+/// out.
+bool lk_soa_get_records(lk_soa* soa, size_t index, size_t count, void* out);
+
+/// Macro for access to the column of a field as an array of type.
+/// Beware: returns NULL on failure.
+#define lk_soa_column(soa, type, field) \
+    (type*)lk_soa_column_raw(soa, field)
+
+/// Returns a pointer to the column of field, which holds soa->size
+/// elements of field_sizes[field] bytes back to back. It stays valid until
+/// soa grows. Returns NULL on failure, or if soa has no data yet.
+void* lk_soa_column_raw(lk_soa* soa, size_t field);
+
+/// Returns a pointer to field of the record at index.
+/// Returns NULL on failure (does bounds checking).
+void* lk_soa_field_at(lk_soa* soa, size_t field, size_t index);
+
+#endif // LK_SOA_H
@@ -1,6 +1,176 @@
 #include <stdio.h>
 #include <math.h>
 #include "lk_array.h"
+#include "lk_segmented.h"
+#include "lk_concurrent.h"
+#include "lk_mapped.h"
+#include "lk_algorithm.h"
+#include "lk_ring.h"
+#include "lk_soa.h"
+#include "lk_bits.h"
+#include "lk_parallel.h"
+#include "lk_serial.h"
+#include "lk_fd.h"
+#include "lk_hash.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+LK_ARRAY_DECLARE(float_array, float)
+
+#define PRODUCERS 8
+#define PRODUCER_ITEMS 20000
+
+struct producer {
+    lk_concurrent_array* arr;
+    uint64_t             id;
+    bool                 ok;
+};
+
+static void* producer_main(void* arg) {
+    struct producer* p = arg;
+    p->ok              = true;
+    for (uint64_t i = 0; i < PRODUCER_ITEMS; ++i) {
+        uint64_t value = (p->id << 32) | i;
+        p->ok          = lk_concurrent_push_back(p->arr, &value) && p->ok;
+    }
+    return NULL;
+}
+
+#define SPSC_ITEMS 200000
+
+static void* spsc_producer_main(void* arg) {
+    lk_spsc_ring* ring = arg;
+    for (uint64_t i = 0; i < SPSC_ITEMS; ++i) {
+        while (!lk_spsc_push(ring, &i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static size_t realloc_hook_calls = 0;
+
+static void count_reallocs(lk_array* arr, size_t old_capacity, size_t new_capacity) {
+    (void)arr;
+    (void)old_capacity;
+    (void)new_capacity;
+    ++realloc_hook_calls;
+}
+
+struct record {
+    uint32_t id;
+    int32_t  key;
+};
+
+struct sample {
+    uint32_t id;
+    double   value;
+    char     tag;
+};
+
+static int compare_int(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_record_key(const void* a, const void* b) {
+    int32_t x = ((const struct record*)a)->key;
+    int32_t y = ((const struct record*)b)->key;
+    return (x > y) - (x < y);
+}
+
+static void store_index(void* first, size_t count, size_t index, void* ctx) {
+    (void)ctx;
+    uint64_t* values = first;
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = index + i;
+    }
+}
+
+static void sum_values(void* acc, const void* first, size_t count, void* ctx) {
+    (void)ctx;
+    const uint64_t* values = first;
+    for (size_t i = 0; i < count; ++i) {
+        *(uint64_t*)acc += values[i];
+    }
+}
+
+static void add_sums(void* acc, const void* other, void* ctx) {
+    (void)ctx;
+    *(uint64_t*)acc += *(const uint64_t*)other;
+}
+
+// fills the array in ctx from inside a parallel call
+static void fill_nested(void* first, size_t count, size_t index, void* ctx) {
+    (void)first;
+    (void)count;
+    if (index == 0) {
+        uint64_t value = 7;
+        lk_parallel_fill(ctx, &value);
+    }
+}
+
+// lk_allocator which keeps track of the bytes it hands out
+static size_t counted_bytes = 0;
+
+static void* counted_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    counted_bytes += size;
+    return malloc(size);
+}
+
+static void* counted_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    counted_bytes += new_size - old_size;
+    return realloc(ptr, new_size);
+}
+
+static void counted_free(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    counted_bytes -= size;
+    free(ptr);
+}
+
+// lk_allocator which refuses blocks over 1 GiB, and keeps the size of the
+// last one it refused
+static size_t refused_size = 0;
+
+static void* refusing_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    if (size > ((size_t)1 << 30)) {
+        refused_size = size;
+        return NULL;
+    }
+    return malloc(size);
+}
+
+static void* refusing_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    if (new_size > ((size_t)1 << 30)) {
+        refused_size = new_size;
+        return NULL;
+    }
+    return realloc(ptr, new_size);
+}
+
+static void refusing_free(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+// puts every key into the same home slot
+static uint64_t collide(const void* key, size_t key_size) {
+    (void)key;
+    (void)key_size;
+    return 42;
+}
 
 static void error_in_lk_array(const char* error) {
     fprintf(stderr, "lk_array error: %s\n", error);
@@ -269,7 +439,7 @@ int main() {
         test(arr != NULL);
         test(arr->data != NULL);
         test(arr->size == 1);
-        test(arr->capacity == 1);
+        test(arr->capacity >= 1);
         test(arr->memb_size == sizeof(struct dat));
 
         struct dat* ptr = arr->data;
@@ -281,7 +451,7 @@ int main() {
         test(arr != NULL);
         test(arr->data != NULL);
         test(arr->size == 2);
-        test(arr->capacity == 2);
+        test(arr->capacity >= 2);
         test(arr->memb_size == sizeof(struct dat));
 
         ptr = arr->data;
@@ -298,6 +468,167 @@ int main() {
         test(lk_push_back(arr, NULL) == false);
     }
 
+    {
+        section("push_back grows geometrically");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        test(lk_set_growth_policy(arr, 2.0, 8));
+        int value = 0;
+        test(lk_push_back(arr, &value));
+        test(arr->capacity == 8);
+        size_t reallocs      = 1;
+        size_t last_capacity = arr->capacity;
+        for (value = 1; value < 1000; ++value) {
+            lk_push_back(arr, &value);
+            if (arr->capacity != last_capacity) {
+                test(arr->capacity == last_capacity * 2);
+                last_capacity = arr->capacity;
+                ++reallocs;
+            }
+        }
+        test(arr->size == 1000);
+        test(reallocs == 8);
+        int* data = arr->data;
+        test(data[0] == 0);
+        test(data[999] == 999);
+        lk_free_array(arr);
+    }
+
+    {
+        section("push_back with growth factor 1.5");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        test(lk_set_growth_policy(arr, 1.5, 2));
+        int value = 1;
+        test(lk_push_back(arr, &value));
+        test(arr->capacity == 2);
+        test(lk_push_back(arr, &value));
+        test(lk_push_back(arr, &value));
+        test(arr->capacity == 3);
+        test(lk_push_back(arr, &value));
+        test(arr->capacity == 4);
+        test(lk_push_back(arr, &value));
+        test(arr->capacity == 6);
+        lk_free_array(arr);
+    }
+
+    {
+        section("set growth policy invalid");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        test(lk_set_growth_policy(arr, 1.0, 4) == false);
+        test(lk_set_growth_policy(arr, 0.5, 4) == false);
+        test(lk_set_growth_policy(NULL, 2.0, 4) == false);
+        lk_free_array(arr);
+    }
+
+    {
+        section("growth doesn't overflow");
+        lk_allocator refusing = { refusing_alloc, refusing_realloc, refusing_free, NULL, NULL };
+        lk_array*    arr      = lk_new_array_with_allocator(4, sizeof(uint64_t), &refusing);
+        test(arr != NULL);
+        test(lk_grow_internal(arr, SIZE_MAX / 4) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        // capacity times the factor is far beyond SIZE_MAX
+        test(lk_set_growth_policy(arr, 1e30, 0));
+        uint64_t value = 1;
+        test(lk_push_back(arr, &value) == false);
+        test(lk_last_error() == LK_ERR_ALLOC);
+        test(refused_size == SIZE_MAX / sizeof(uint64_t) * sizeof(uint64_t));
+        test(arr->size == 4 && arr->capacity == 4);
+        lk_free_array(arr);
+    }
+
+    {
+        section("resize after push_back stays exact");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        int value = 1;
+        test(lk_push_back(arr, &value));
+        test(lk_resize(arr, 100));
+        test(arr->size == 100);
+        test(arr->capacity == 100);
+        lk_free_array(arr);
+    }
+
+    {
+        section("append_n");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        int values[] = { 1, 2, 3, 4, 5 };
+        test(lk_append_n(arr, values, 5));
+        test(arr->size == 5);
+        test(lk_append_n(arr, values, 2));
+        test(arr->size == 7);
+        int* data = arr->data;
+        test(data[0] == 1);
+        test(data[4] == 5);
+        test(data[5] == 1);
+        test(data[6] == 2);
+        test(lk_append_n(arr, values, 0));
+        test(arr->size == 7);
+        test(lk_append_n(arr, NULL, 1) == false);
+        test(lk_append_n(NULL, values, 1) == false);
+        lk_free_array(arr);
+    }
+
+    {
+        section("insert_range and erase_range");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        int values[] = { 1, 2, 3, 4, 5 };
+        int middle[] = { 10, 20 };
+        test(lk_append_n(arr, values, 5));
+        test(lk_insert_range(arr, 2, middle, 2));
+        test(arr->size == 7);
+        int* data = arr->data;
+        test(data[1] == 2);
+        test(data[2] == 10);
+        test(data[3] == 20);
+        test(data[4] == 3);
+        test(data[6] == 5);
+        test(lk_insert_range(arr, 0, middle, 1));
+        data = arr->data;
+        test(data[0] == 10);
+        test(data[1] == 1);
+        test(lk_insert_range(arr, 9, middle, 1) == false);
+        test(lk_erase_range(arr, 0, 1));
+        test(lk_erase_range(arr, 2, 2));
+        test(arr->size == 5);
+        data = arr->data;
+        test(data[0] == 1);
+        test(data[1] == 2);
+        test(data[2] == 3);
+        test(data[4] == 5);
+        test(lk_erase_range(arr, 3, 3) == false);
+        test(lk_erase_range(arr, 3, 2));
+        test(arr->size == 3);
+        lk_free_array(arr);
+    }
+
+    {
+        section("pop_back and swap_remove");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        int values[] = { 1, 2, 3, 4 };
+        test(lk_append_n(arr, values, 4));
+        int out = 0;
+        test(lk_pop_back(arr, &out));
+        test(out == 4);
+        test(arr->size == 3);
+        test(lk_swap_remove(arr, 0));
+        test(arr->size == 2);
+        int* data = arr->data;
+        test(data[0] == 3);
+        test(data[1] == 2);
+        test(lk_swap_remove(arr, 1));
+        test(lk_swap_remove(arr, 1) == false);
+        test(lk_pop_back(arr, NULL));
+        test(arr->size == 0);
+        test(lk_pop_back(arr, &out) == false);
+        lk_free_array(arr);
+    }
+
     {
         section("lk_at int");
         lk_array* arr = lk_new_array(0, sizeof(int));
@@ -322,5 +653,1377 @@ int main() {
         test(*lk_at(arr, int, 16) == value);
     }
 
+    {
+        section("unchecked access");
+        lk_array* arr = lk_new_array(10, sizeof(int));
+        test(arr != NULL);
+        for (int i = 0; i < 10; ++i) {
+            test(lk_set_unchecked(arr, (size_t)i, &i));
+        }
+        int sum = 0;
+        for (size_t i = 0; i < arr->size; ++i) {
+            sum += *lk_at_unchecked(arr, int, i);
+        }
+        test(sum == 45);
+        test(*(int*)lk_at_raw_unchecked(arr, 3) == 3);
+        test(lk_get_raw_unchecked(arr) == arr->data);
+        lk_free_array(arr);
+    }
+
+    {
+        section("typed array push, at, set");
+        float_array* arr = float_array_new(0);
+        test(arr != NULL);
+        for (int i = 0; i < 100; ++i) {
+            test(float_array_push(arr, (float)i));
+        }
+        test(float_array_as_array(arr)->size == 100);
+        test(*float_array_at(arr, 50) == 50.0f);
+        test(float_array_set(arr, 50, 1.5f));
+        test(float_array_data(arr)[50] == 1.5f);
+        test(float_array_at(arr, 100) == NULL);
+        test(float_array_set(arr, 100, 1.0f) == false);
+        test(float_array_reserve(arr, 500));
+        test(float_array_as_array(arr)->capacity == 500);
+        float_array_free(arr);
+    }
+
+    {
+        section("typed array conversion");
+        lk_array* arr = lk_new_array(3, sizeof(float));
+        test(arr != NULL);
+        float_array* typed = float_array_from_array(arr);
+        test(typed != NULL);
+        test(float_array_set(typed, 2, 4.0f));
+        test(*lk_at(arr, float, 2) == 4.0f);
+        test(float_array_as_array(typed) == arr);
+        lk_array* wrong = lk_new_array(3, sizeof(double));
+        test(float_array_from_array(wrong) == NULL);
+        lk_free_array(wrong);
+        lk_free_array(arr);
+    }
+
+    {
+        section("last error codes");
+        lk_clear_error();
+        test(lk_last_error() == LK_OK);
+        lk_array* arr = lk_new_array(2, sizeof(int));
+        test(arr != NULL);
+        test(lk_swap_remove(arr, 2) == false);
+        test(lk_last_error() == LK_ERR_OUT_OF_BOUNDS);
+        // successful calls don't reset the error
+        test(lk_reserve(arr, 4));
+        test(lk_last_error() == LK_ERR_OUT_OF_BOUNDS);
+        test(lk_push_back(NULL, &arr) == false);
+        test(lk_last_error() == LK_ERR_NULL);
+        test(lk_new_array(1, 0) == NULL);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        test(lk_resize(arr, 0));
+        test(lk_pop_back(arr, NULL) == false);
+        test(lk_last_error() == LK_ERR_EMPTY);
+        lk_clear_error();
+        test(lk_last_error() == LK_OK);
+        test(lk_error_string(LK_ERR_OUT_OF_BOUNDS) != NULL);
+        lk_free_array(arr);
+    }
+
+    {
+        section("last error without callback");
+        lk_setup_error_callback(NULL);
+        lk_array* arr = lk_new_array(1, sizeof(int));
+        test(arr != NULL);
+        test(lk_erase_range(arr, 5, 1) == false);
+        test(lk_last_error() == LK_ERR_OUT_OF_BOUNDS);
+        lk_free_array(arr);
+        lk_setup_error_callback(error_in_lk_array);
+    }
+
+    {
+        section("arena allocator");
+        lk_arena arena;
+        test(lk_arena_init(&arena, 4096));
+        lk_allocator* allocator = lk_arena_allocator(&arena);
+        test(allocator != NULL);
+        lk_array* arrays[64];
+        for (int i = 0; i < 64; ++i) {
+            arrays[i] = lk_new_array_with_allocator(2, sizeof(int), allocator);
+            test(arrays[i] != NULL);
+            test(arrays[i]->allocator == allocator);
+            test(*lk_at(arrays[i], int, 1) == 0);
+            for (int k = 0; k < 100; ++k) {
+                lk_push_back(arrays[i], &k);
+            }
+        }
+        test(arrays[63]->size == 102);
+        test(*lk_at(arrays[63], int, 101) == 99);
+        test(*lk_at(arrays[0], int, 50) == 48);
+        // huge arrays get a chunk of their own
+        lk_array* big = lk_new_array_with_allocator(10000, sizeof(int), allocator);
+        test(big != NULL);
+        test(lk_set(big, 9999, &big->size));
+        lk_arena_reset(&arena);
+        lk_array* again = lk_new_array_with_allocator(2, sizeof(int), allocator);
+        test(again != NULL);
+        lk_free_array(again);
+        lk_arena_destroy(&arena);
+        test(lk_arena_init(&arena, 0) == false);
+    }
+
+    {
+        section("pool allocator");
+        lk_pool pool;
+        test(lk_pool_init(&pool, 4096));
+        lk_allocator* allocator = lk_pool_allocator(&pool);
+        lk_array*     arr       = lk_new_array_with_allocator(0, sizeof(int), allocator);
+        test(arr != NULL);
+        lk_array* first = arr;
+        lk_free_array(arr);
+        // the header is recycled
+        arr = lk_new_array_with_allocator(0, sizeof(int), allocator);
+        test(arr == first);
+        for (int k = 0; k < 1000; ++k) {
+            lk_push_back(arr, &k);
+        }
+        test(arr->size == 1000);
+        test(*lk_at(arr, int, 999) == 999);
+        test(*lk_at(arr, int, 3) == 3);
+        lk_array* copy = lk_new_array_with_allocator(0, sizeof(int), allocator);
+        test(lk_array_deep_copy(copy, arr));
+        test(*lk_at(copy, int, 999) == 999);
+        lk_free_array(copy);
+        lk_free_array(arr);
+        lk_pool_destroy(&pool);
+    }
+
+    {
+        section("inline array");
+        lk_array* arr = lk_new_array_inline(2, sizeof(int), 4 * sizeof(int), NULL);
+        test(arr != NULL);
+        test(arr->size == 2);
+        test(arr->capacity == 4);
+        test(*lk_at(arr, int, 1) == 0);
+        void* inline_data = lk_get_raw(arr);
+        // data lives right behind the header
+        test((char*)inline_data > (char*)arr);
+        test((char*)inline_data < (char*)arr + sizeof(lk_array) + 64);
+        int value = 3;
+        test(lk_push_back(arr, &value));
+        value = 4;
+        test(lk_push_back(arr, &value));
+        test(lk_get_raw(arr) == inline_data);
+        value = 5;
+        test(lk_push_back(arr, &value));
+        // spilled to the heap
+        test(lk_get_raw(arr) != inline_data);
+        test(arr->size == 5);
+        test(*lk_at(arr, int, 2) == 3);
+        test(*lk_at(arr, int, 3) == 4);
+        test(*lk_at(arr, int, 4) == 5);
+        test(lk_resize(arr, 0));
+        test(lk_get_raw(arr) == inline_data);
+        test(arr->capacity == 4);
+        test(lk_push_back(arr, &value));
+        test(*lk_at(arr, int, 0) == 5);
+        lk_free_array(arr);
+    }
+
+    {
+        section("inline array larger than buffer");
+        lk_array* arr = lk_new_array_inline(10, sizeof(int), 4 * sizeof(int), NULL);
+        test(arr != NULL);
+        test(arr->size == 10);
+        test(arr->capacity == 10);
+        test(*lk_at(arr, int, 9) == 0);
+        lk_array* copy = lk_new_array_inline(0, sizeof(int), 4 * sizeof(int), NULL);
+        test(copy != NULL);
+        test(lk_array_deep_copy(copy, arr));
+        test(copy->size == 10);
+        lk_free_array(copy);
+        lk_free_array(arr);
+    }
+
+    {
+        section("segmented array push_back and at");
+        lk_segmented_array* arr = lk_new_segmented_array(0, sizeof(int), 100);
+        test(arr != NULL);
+        // rounded up to a power of two
+        test(arr->chunk_shift == 7);
+        int value = 0;
+        test(lk_segmented_push_back(arr, &value));
+        int* first = lk_segmented_at(arr, int, 0);
+        test(first != NULL);
+        for (value = 1; value < 1000; ++value) {
+            test(lk_segmented_push_back(arr, &value));
+        }
+        test(arr->size == 1000);
+        test(lk_segmented_capacity(arr) == 1024);
+        // elements don't move when growing
+        test(lk_segmented_at(arr, int, 0) == first);
+        test(*lk_segmented_at(arr, int, 128) == 128);
+        test(*lk_segmented_at(arr, int, 999) == 999);
+        test(lk_segmented_at(arr, int, 1000) == NULL);
+        value = 42;
+        test(lk_segmented_set(arr, 500, &value));
+        test(*lk_segmented_at(arr, int, 500) == 42);
+        test(lk_segmented_set(arr, 1000, &value) == false);
+        test(lk_segmented_push_back(arr, NULL) == false);
+        lk_free_segmented_array(arr);
+        test(arr == NULL);
+    }
+
+    {
+        section("segmented array reserve and resize");
+        lk_segmented_array* arr = lk_new_segmented_array(10, sizeof(double), 0);
+        test(arr != NULL);
+        test(arr->size == 10);
+        test(*lk_segmented_at(arr, double, 9) == 0.0);
+        test(lk_segmented_reserve(arr, 5) == false);
+        test(lk_segmented_reserve(arr, 5000));
+        test(lk_segmented_capacity(arr) >= 5000);
+        test(arr->size == 10);
+        double value = 1.5;
+        test(lk_segmented_set(arr, 9, &value));
+        test(lk_segmented_resize(arr, 5));
+        test(lk_segmented_resize(arr, 3000));
+        test(*lk_segmented_at(arr, double, 9) == 0.0);
+        test(*lk_segmented_at(arr, double, 2999) == 0.0);
+        lk_free_segmented_array(arr);
+
+        // shrink into the middle of a chunk and grow across several
+        arr = lk_new_segmented_array(0, sizeof(int), 16);
+        for (int i = 0; i < 100; ++i) {
+            test(lk_segmented_push_back(arr, &i));
+        }
+        test(lk_segmented_resize(arr, 7));
+        test(lk_segmented_resize(arr, 90));
+        bool zeroed = true;
+        for (size_t i = 7; i < 90; ++i) {
+            zeroed = zeroed && *lk_segmented_at(arr, int, i) == 0;
+        }
+        test(zeroed);
+        test(*lk_segmented_at(arr, int, 6) == 6);
+        // grow past the old chunks, which only get cleared up to their end
+        test(lk_segmented_resize(arr, 50));
+        test(lk_segmented_resize(arr, 300));
+        for (size_t i = 50; i < 300; ++i) {
+            zeroed = zeroed && *lk_segmented_at(arr, int, i) == 0;
+        }
+        test(zeroed);
+        lk_free_segmented_array(arr);
+        test(lk_new_segmented_array(1, 0, 0) == NULL);
+    }
+
+    {
+        section("concurrent array single thread");
+        lk_concurrent_array* arr = lk_new_concurrent_array(sizeof(int), 4);
+        test(arr != NULL);
+        test(lk_concurrent_size(arr) == 0);
+        test(lk_concurrent_at(arr, int, 0) == NULL);
+        int* first = NULL;
+        for (int i = 0; i < 1000; ++i) {
+            test(lk_concurrent_push_back(arr, &i));
+            if (i == 0) {
+                first = lk_concurrent_at(arr, int, 0);
+            }
+        }
+        test(lk_concurrent_size(arr) == 1000);
+        test(lk_concurrent_at(arr, int, 0) == first);
+        test(*lk_concurrent_at(arr, int, 3) == 3);
+        test(*lk_concurrent_at(arr, int, 4) == 4);
+        test(*lk_concurrent_at(arr, int, 999) == 999);
+        test(lk_concurrent_at(arr, int, 1000) == NULL);
+        test(lk_concurrent_reserve(arr, 100000));
+        lk_free_concurrent_array(arr);
+        test(arr == NULL);
+    }
+
+    {
+        section("concurrent array writers don't wait for a stalled one");
+        lk_concurrent_array* arr = lk_new_concurrent_array(sizeof(int), 4);
+        for (int i = 0; i < 3; ++i) {
+            test(lk_concurrent_push_back(arr, &i));
+        }
+        // claim slot 3 like a writer that never gets to write it
+        atomic_fetch_add(&arr->reserved, 1);
+        for (int i = 4; i < 6; ++i) {
+            test(lk_concurrent_push_back(arr, &i));
+        }
+        test(lk_concurrent_size(arr) == 3);
+        test(lk_concurrent_at(arr, int, 3) == NULL);
+        test(lk_concurrent_at(arr, int, 5) == NULL);
+        test(*lk_concurrent_at(arr, int, 2) == 2);
+        lk_free_concurrent_array(arr);
+    }
+
+    {
+        section("concurrent array multi-threaded stress");
+        lk_concurrent_array* arr = lk_new_concurrent_array(sizeof(uint64_t), 16);
+        test(arr != NULL);
+        pthread_t       threads[PRODUCERS];
+        struct producer producers[PRODUCERS];
+        for (uint64_t i = 0; i < PRODUCERS; ++i) {
+            producers[i].arr = arr;
+            producers[i].id  = i;
+            pthread_create(&threads[i], NULL, producer_main, &producers[i]);
+        }
+        // read concurrently, everything below size has to be fully written
+        bool   reads_ok = true;
+        size_t size     = 0;
+        while (size < PRODUCERS * PRODUCER_ITEMS) {
+            size = lk_concurrent_size(arr);
+            if (size > 0) {
+                uint64_t* last = lk_concurrent_at(arr, uint64_t, size - 1);
+                reads_ok       = reads_ok && last && (*last >> 32) < PRODUCERS;
+            }
+        }
+        for (int i = 0; i < PRODUCERS; ++i) {
+            pthread_join(threads[i], NULL);
+            test(producers[i].ok);
+        }
+        test(reads_ok);
+        test(lk_concurrent_size(arr) == PRODUCERS * PRODUCER_ITEMS);
+        // every value is there exactly once, and each producer's values are in order
+        uint64_t next[PRODUCERS] = { 0 };
+        bool     order_ok        = true;
+        for (size_t i = 0; i < lk_concurrent_size(arr); ++i) {
+            uint64_t value = *lk_concurrent_at(arr, uint64_t, i);
+            uint64_t id    = value >> 32;
+            order_ok       = order_ok && id < PRODUCERS && (value & 0xffffffff) == next[id];
+            if (id < PRODUCERS) {
+                ++next[id];
+            }
+        }
+        test(order_ok);
+        lk_free_concurrent_array(arr);
+    }
+
+    {
+        section("mapped array create, grow, reopen");
+        char path[] = "/tmp/lk_mapped_test_XXXXXX";
+        int  fd     = mkstemp(path);
+        test(fd >= 0);
+        close(fd);
+        lk_mapped_array* mapped = lk_mapped_create(path, sizeof(int));
+        test(mapped != NULL);
+        lk_array* arr = lk_mapped_get_array(mapped);
+        test(arr->size == 0);
+        for (int i = 0; i < 10000; ++i) {
+            lk_push_back(arr, &i);
+        }
+        test(arr->size == 10000);
+        test(*lk_at(arr, int, 9999) == 9999);
+        test(lk_mapped_sync(mapped, false));
+        lk_mapped_close(mapped);
+        test(mapped == NULL);
+
+        mapped = lk_mapped_open(path, false);
+        test(mapped != NULL);
+        arr = lk_mapped_get_array(mapped);
+        test(arr->size == 10000);
+        test(arr->memb_size == sizeof(int));
+        test(*lk_at(arr, int, 0) == 0);
+        test(*lk_at(arr, int, 1234) == 1234);
+        // private mapping: changes are not written back, growing fails
+        int value = -1;
+        test(lk_set(arr, 0, &value));
+        test(lk_push_back(arr, &value) == false);
+        test(lk_mapped_sync(mapped, false) == false);
+        lk_mapped_close(mapped);
+
+        mapped = lk_mapped_open(path, true);
+        test(mapped != NULL);
+        arr = lk_mapped_get_array(mapped);
+        test(*lk_at(arr, int, 0) == 0);
+        test(lk_push_back(arr, &value));
+        lk_mapped_close(mapped);
+
+        mapped = lk_mapped_open(path, false);
+        test(mapped != NULL);
+        arr = lk_mapped_get_array(mapped);
+        test(arr->size == 10001);
+        test(*lk_at(arr, int, 10000) == -1);
+        lk_mapped_close(mapped);
+        unlink(path);
+        test(lk_mapped_open(path, false) == NULL);
+    }
+
+    {
+        section("stats");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        lk_stats stats;
+#ifdef LK_STATS
+        lk_stats global_before;
+        test(lk_global_stats(&global_before));
+        lk_set_realloc_hook(count_reallocs);
+        test(lk_set_growth_policy(arr, 2.0, 4));
+        for (int i = 0; i < 10; ++i) {
+            lk_push_back(arr, &i);
+        }
+        test(lk_at_raw(arr, 10) == NULL);
+        test(lk_array_stats(arr, &stats));
+        // 4, 8, 16
+        test(stats.reallocs == 3);
+        test(realloc_hook_calls == 3);
+        test(stats.peak_capacity == 16 * sizeof(int));
+        test(stats.wasted_capacity == 6 * sizeof(int));
+        test(stats.bounds_failures == 1);
+        test(stats.allocator_calls == 4);
+        // 10 pushes, and the reallocations moved 4 + 8 elements
+        test(stats.bytes_moved == (10 + 4 + 8) * sizeof(int));
+        lk_stats global_after;
+        test(lk_global_stats(&global_after));
+        test(global_after.reallocs - global_before.reallocs == 3);
+        test(global_after.bounds_failures - global_before.bounds_failures == 1);
+        lk_set_realloc_hook(NULL);
+#else
+        (void)count_reallocs;
+        test(lk_array_stats(arr, &stats) == false);
+        test(lk_global_stats(&stats) == false);
+#endif // LK_STATS
+        lk_free_array(arr);
+    }
+
+    {
+        section("deep copy copies all bytes");
+        lk_array* src = lk_new_array(0, sizeof(int));
+        test(src != NULL);
+        for (int i = 0; i < 100; ++i) {
+            lk_push_back(src, &i);
+        }
+        lk_array* dest = lk_new_array(0, sizeof(int));
+        test(lk_array_deep_copy(dest, src));
+        test(*lk_at(dest, int, 0) == 0);
+        test(*lk_at(dest, int, 99) == 99);
+        lk_free_array(dest);
+        lk_free_array(src);
+    }
+
+    {
+        section("swap and move");
+        lk_array* a = lk_new_array(3, sizeof(int));
+        lk_array* b = lk_new_array(5, sizeof(double));
+        test(a != NULL && b != NULL);
+        void* a_data = a->data;
+        void* b_data = b->data;
+        test(lk_array_swap(a, b));
+        test(a->data == b_data);
+        test(a->size == 5);
+        test(a->memb_size == sizeof(double));
+        test(b->data == a_data);
+        test(b->size == 3);
+        test(lk_array_move(a, b));
+        test(a->data == a_data);
+        test(a->size == 3);
+        test(a->memb_size == sizeof(int));
+        test(b->size == 0);
+        test(b->data == NULL);
+        test(lk_array_swap(a, NULL) == false);
+        lk_free_array(a);
+        lk_free_array(b);
+    }
+
+    {
+        section("swap and move inline arrays");
+        lk_array* a = lk_new_array_inline(2, sizeof(int), 16, NULL);
+        lk_array* b = lk_new_array(0, sizeof(int));
+        test(a != NULL && b != NULL);
+        int value = 7;
+        test(lk_set(a, 1, &value));
+        test(lk_array_swap(a, b));
+        test(b->size == 2);
+        test(*lk_at(b, int, 1) == 7);
+        test(a->size == 0);
+        lk_array* c = lk_new_array_inline(1, sizeof(int), 16, NULL);
+        test(lk_set(c, 0, &value));
+        test(lk_array_move(b, c));
+        test(b->size == 1);
+        test(*lk_at(b, int, 0) == 7);
+        test(c->size == 0);
+        test(c->capacity == 4);
+        lk_free_array(a);
+        lk_free_array(b);
+        lk_free_array(c);
+    }
+
+    {
+        section("move between different allocators");
+        lk_allocator counted = { counted_alloc, counted_realloc, counted_free, NULL, NULL };
+        lk_array*    src     = lk_new_array_with_allocator(1000, sizeof(int), &counted);
+        lk_array*    dest    = lk_new_array(0, sizeof(int));
+        test(src != NULL && dest != NULL);
+        int value = 5;
+        test(lk_set(src, 999, &value));
+        test(lk_array_move(dest, src));
+        test(dest->size == 1000);
+        test(*lk_at(dest, int, 999) == 5);
+        test(src->size == 0 && src->data == NULL);
+        lk_free_array(src);
+        // src's data was freed by the move, not leaked
+        test(counted_bytes == 0);
+        lk_free_array(dest);
+    }
+
+    {
+        section("copy and move from empty arrays");
+        lk_array* dest = lk_new_array(4, 4);
+        lk_array* src  = lk_new_array(0, 4);
+        test(lk_array_deep_copy(dest, src));
+        test(dest->size == 0);
+        // dest is still usable, and freeing it doesn't free its data twice
+        int value = 3;
+        test(lk_push_back(dest, &value));
+        test(*lk_at(dest, int, 0) == 3);
+        lk_free_array(dest);
+        lk_free_array(src);
+
+        // an inline src is always copied
+        dest = lk_new_array(4, 4);
+        src  = lk_new_array_inline(0, 4, 64, NULL);
+        test(lk_array_move(dest, src));
+        test(dest->size == 0);
+        test(lk_push_back(dest, &value));
+        test(*lk_at(dest, int, 0) == 3);
+        lk_free_array(dest);
+        lk_free_array(src);
+    }
+
+    {
+        section("adopt and release");
+        int* buf = LK_MALLOC(4 * sizeof(int));
+        test(buf != NULL);
+        for (int i = 0; i < 3; ++i) {
+            buf[i] = i * 10;
+        }
+        lk_array* arr = lk_array_adopt(buf, 3, 4, sizeof(int));
+        test(arr != NULL);
+        test(arr->data == buf);
+        test(*lk_at(arr, int, 2) == 20);
+        int value = 30;
+        test(lk_push_back(arr, &value));
+        test(arr->data == buf);
+        size_t size     = 0;
+        int*   released = lk_array_release(arr, &size);
+        test(released == buf);
+        test(size == 4);
+        test(arr->size == 0);
+        test(arr->data == NULL);
+        test(released[3] == 30);
+        LK_FREE(released);
+        test(lk_array_adopt(NULL, 1, 1, sizeof(int)) == NULL);
+        test(lk_array_adopt(buf, 2, 1, sizeof(int)) == NULL);
+        lk_free_array(arr);
+    }
+
+    {
+        section("slices");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        for (int i = 0; i < 10; ++i) {
+            lk_push_back(arr, &i);
+        }
+        lk_array_view view = lk_array_slice(arr, 2, 5);
+        test(view.size == 5);
+        test(view.memb_size == sizeof(int));
+        test(*lk_view_at(&view, int, 0) == 2);
+        test(*lk_view_at(&view, int, 4) == 6);
+        test(lk_view_at(&view, int, 5) == NULL);
+        // no copy
+        test(lk_view_at(&view, int, 0) == lk_at(arr, int, 2));
+        view = lk_array_slice(arr, 8, 3);
+        test(view.data == NULL);
+        test(view.size == 0);
+        lk_free_array(arr);
+    }
+
+    {
+        section("copy-on-write sharing");
+        lk_array* a = lk_new_array(0, sizeof(int));
+        lk_array* b = lk_new_array(0, sizeof(int));
+        lk_array* c = lk_new_array_inline(0, sizeof(int), 16, NULL);
+        test(a != NULL && b != NULL && c != NULL);
+        for (int i = 0; i < 8; ++i) {
+            lk_push_back(a, &i);
+        }
+        test(lk_array_share(b, a));
+        test(lk_array_share(c, a));
+        test(b->data == a->data);
+        test(c->data == a->data);
+        test(b->size == 8);
+        test(lk_array_is_shared(a));
+        int value = 42;
+        // writing copies
+        test(lk_swap_remove(b, 3));
+        test(b->data != a->data);
+        test(*lk_at(b, int, 3) == 7);
+        test(*lk_at(a, int, 3) == 3);
+        test(!lk_array_is_shared(b));
+        test(lk_array_is_shared(a));
+        test(lk_push_back(c, &value));
+        test(c->data != a->data);
+        test(c->size == 9);
+        test(*lk_at(c, int, 8) == 42);
+        // a is the last owner and takes the buffer back
+        test(!lk_array_is_shared(a));
+        void* data = a->data;
+        test(lk_erase_range(a, 0, 1));
+        test(a->data == data);
+        test(*lk_at(a, int, 0) == 1);
+        // freeing a sharing array leaves the other intact
+        test(lk_array_share(b, a));
+        lk_free_array(a);
+        test(*lk_at(b, int, 6) == 7);
+        // lk_set copies too, also with LK_UNCHECKED_ACCESS
+        lk_array* snapshot = lk_new_array(0, sizeof(int));
+        test(lk_array_share(snapshot, b));
+        test(lk_set(b, 0, &value));
+        test(*lk_at(b, int, 0) == 42);
+        test(*lk_at(snapshot, int, 0) == 1);
+        lk_free_array(snapshot);
+        test(lk_array_unshare(b));
+        test(lk_array_share(b, NULL) == false);
+        test(lk_last_error() == LK_ERR_NULL);
+        lk_free_array(b);
+        lk_free_array(c);
+    }
+
+    {
+        section("sort and binary search");
+        lk_array* arr = lk_new_array(0, sizeof(int));
+        test(arr != NULL);
+        for (int i = 0; i < 100; ++i) {
+            int value = (i * 37) % 50;
+            lk_push_back(arr, &value);
+        }
+        test(lk_sort(arr, compare_int));
+        bool sorted = true;
+        for (size_t i = 1; i < arr->size; ++i) {
+            sorted = sorted && *lk_at(arr, int, i - 1) <= *lk_at(arr, int, i);
+        }
+        test(sorted);
+        int key = 20;
+        test(lk_lower_bound(arr, &key, compare_int) == 40);
+        test(lk_upper_bound(arr, &key, compare_int) == 42);
+        size_t index = 0;
+        test(lk_binary_search(arr, &key, compare_int, &index));
+        test(index == 40);
+        key = 50;
+        test(lk_lower_bound(arr, &key, compare_int) == 100);
+        test(!lk_binary_search(arr, &key, compare_int, &index));
+        key = -1;
+        test(lk_upper_bound(arr, &key, compare_int) == 0);
+        test(lk_sort(arr, NULL) == false);
+        test(lk_last_error() == LK_ERR_NULL);
+        test(lk_binary_search(arr, NULL, compare_int, NULL) == false);
+        lk_free_array(arr);
+    }
+
+    {
+        section("stable sort and radix sort");
+        lk_array* a = lk_new_array(0, sizeof(struct record));
+        lk_array* b = lk_new_array(0, sizeof(struct record));
+        test(a != NULL && b != NULL);
+        uint64_t state = 12345;
+        for (uint32_t i = 0; i < 1000; ++i) {
+            state           = state * 6364136223846793005ull + 1442695040888963407ull;
+            struct record r = { i, (int32_t)(state >> 40) % 200 - 100 };
+            lk_push_back(a, &r);
+        }
+        test(lk_array_deep_copy(b, a));
+        test(lk_stable_sort(a, compare_record_key));
+        test(lk_radix_sort(b, offsetof(struct record, key), sizeof(int32_t), true));
+        bool stable = true;
+        for (size_t i = 1; i < a->size; ++i) {
+            struct record* prev = lk_at(a, struct record, i - 1);
+            struct record* cur  = lk_at(a, struct record, i);
+            stable = stable && (prev->key < cur->key || (prev->key == cur->key && prev->id < cur->id));
+        }
+        test(stable);
+        test(memcmp(a->data, b->data, a->size * sizeof(struct record)) == 0);
+        test((lk_at(a, struct record, 0))->key < 0);
+        // unsigned key
+        test(lk_radix_sort(b, offsetof(struct record, id), sizeof(uint32_t), false));
+        test((lk_at(b, struct record, 999))->id == 999);
+        test(lk_radix_sort(b, 6, 4, false) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        test(lk_radix_sort(b, 0, 3, false) == false);
+        lk_free_array(a);
+        lk_free_array(b);
+    }
+
+    {
+        section("find, count, fill and equal");
+        static const size_t widths[] = { 1, 2, 4, 8, 16, 12 };
+        unsigned char       needle[16];
+        unsigned char       other[16];
+        memset(needle, 0x5a, sizeof(needle));
+        memset(other, 0x5a, sizeof(other));
+        other[0] = 0;
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+            // long enough for the vector loops, with a tail
+            lk_array* arr = lk_new_array(203, widths[w]);
+            test(arr != NULL);
+            size_t index = 0;
+            test(!lk_find(arr, needle, &index));
+            test(lk_count(arr, needle) == 0);
+            test(lk_fill(arr, other));
+            // differs only in the first byte of each element
+            test(!lk_find(arr, needle, &index));
+            test(lk_set(arr, 150, needle));
+            test(lk_set(arr, 201, needle));
+            test(lk_find(arr, needle, &index));
+            test(index == 150);
+            test(lk_count(arr, needle) == 2);
+            test(lk_count(arr, other) == 201);
+            lk_array* copy = lk_new_array(0, widths[w]);
+            test(lk_array_deep_copy(copy, arr));
+            test(lk_equal(copy, arr));
+            test(lk_fill(copy, needle));
+            test(lk_count(copy, needle) == 203);
+            test(!lk_equal(copy, arr));
+            lk_free_array(copy);
+            lk_free_array(arr);
+        }
+        test(lk_find(NULL, needle, NULL) == false);
+        test(lk_last_error() == LK_ERR_NULL);
+        test(lk_equal(NULL, NULL) == false);
+    }
+
+    {
+        section("aligned allocator");
+        lk_aligned aligned;
+        test(lk_aligned_init(&aligned, 64, 0));
+        lk_array* arr = lk_new_array_with_allocator(3, sizeof(int), lk_aligned_allocator(&aligned));
+        test(arr != NULL);
+        test((uintptr_t)arr->data % 64 == 0);
+        bool stays_aligned = true;
+        for (int i = 0; i < 5000; ++i) {
+            lk_push_back(arr, &i);
+            stays_aligned = stays_aligned && (uintptr_t)arr->data % 64 == 0;
+        }
+        test(stays_aligned);
+        test(*lk_at(arr, int, 3) == 0);
+        test(*lk_at(arr, int, 5002) == 4999);
+        lk_free_array(arr);
+        test(lk_aligned_init(&aligned, 48, 0) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+    }
+
+    {
+        section("aligned allocator keeps data across reallocations");
+        lk_aligned aligned;
+        test(lk_aligned_init(&aligned, 64, 0));
+        lk_array* arr = lk_new_array_with_allocator(0, 1, lk_aligned_allocator(&aligned));
+        test(arr != NULL);
+        // check every byte and the alignment whenever the data was
+        // reallocated, small blocks included
+        bool   intact       = true;
+        bool   kept_aligned = true;
+        size_t capacity     = arr->capacity;
+        for (size_t i = 0; i < 20000; ++i) {
+            unsigned char value = (unsigned char)(i * 31);
+            lk_push_back(arr, &value);
+            if (arr->capacity != capacity) {
+                capacity     = arr->capacity;
+                kept_aligned = kept_aligned && (uintptr_t)arr->data % 64 == 0;
+                for (size_t j = 0; j <= i; ++j) {
+                    intact = intact && *lk_at(arr, unsigned char, j) == (unsigned char)(j * 31);
+                }
+            }
+        }
+        test(intact);
+        test(kept_aligned);
+        lk_free_array(arr);
+    }
+
+    {
+        section("aligned allocator with huge pages");
+        lk_aligned aligned;
+        test(lk_aligned_init(&aligned, 4096, (size_t)1 << 20));
+        lk_array* arr = lk_new_array_with_allocator(0, sizeof(uint64_t), lk_aligned_allocator(&aligned));
+        test(arr != NULL);
+        bool stays_aligned = true;
+        for (uint64_t i = 0; i < ((size_t)1 << 20); ++i) {
+            lk_push_back(arr, &i);
+            stays_aligned = stays_aligned && (uintptr_t)arr->data % 4096 == 0;
+        }
+        test(stays_aligned);
+        bool intact = true;
+        for (uint64_t i = 0; i < ((size_t)1 << 20); i += 4099) {
+            intact = intact && *lk_at(arr, uint64_t, i) == i;
+        }
+        test(intact);
+        test(lk_reserve(arr, (size_t)1 << 22));
+        test(*lk_at(arr, uint64_t, ((size_t)1 << 20) - 1) == ((size_t)1 << 20) - 1);
+        lk_free_array(arr);
+        // past the threshold, so mapped and aligned to a huge page
+        arr = lk_new_array_with_allocator((size_t)1 << 18, sizeof(uint64_t), lk_aligned_allocator(&aligned));
+        test(arr != NULL);
+        test((uintptr_t)arr->data % LK_HUGE_PAGE_SIZE == 0);
+        test(*lk_at(arr, uint64_t, 12345) == 0);
+        lk_free_array(arr);
+    }
+
+    {
+        section("uninitialized construction and resize");
+        lk_array* arr = lk_new_array_uninit(100, sizeof(int));
+        test(arr != NULL);
+        test(arr->size == 100);
+        test(arr->capacity == 100);
+        for (int i = 0; i < 100; ++i) {
+            test(lk_set(arr, (size_t)i, &i));
+        }
+        test(lk_resize(arr, 10));
+        // lk_resize zeroes the elements coming back
+        test(lk_resize(arr, 20));
+        test(*lk_at(arr, int, 9) == 9);
+        test(*lk_at(arr, int, 10) == 0);
+        test(*lk_at(arr, int, 19) == 0);
+        // lk_resize_uninit leaves them as they were
+        test(lk_resize(arr, 10));
+        test(lk_resize_uninit(arr, 100));
+        test(*lk_at(arr, int, 50) == 50);
+        test(lk_resize(arr, 200));
+        test(*lk_at(arr, int, 99) == 99);
+        test(*lk_at(arr, int, 150) == 0);
+        test(lk_resize(arr, 0));
+        test(lk_resize(arr, 50));
+        test(*lk_at(arr, int, 49) == 0);
+        test(lk_resize_uninit(NULL, 1) == false);
+        lk_free_array(arr);
+        test(lk_new_array_uninit(1, 0) == NULL);
+    }
+
+    {
+        section("ring buffer");
+        lk_ring* ring = lk_new_ring(sizeof(int), 0);
+        test(ring != NULL);
+        test(ring->capacity == 0);
+        int value = 0;
+        test(lk_ring_pop_front(ring, &value) == false);
+        test(lk_last_error() == LK_ERR_EMPTY);
+        for (int i = 0; i < 6; ++i) {
+            test(lk_ring_push_back(ring, &i));
+        }
+        test(ring->capacity == 8);
+        for (int i = 0; i < 5; ++i) {
+            test(lk_ring_pop_front(ring, &value));
+            test(value == i);
+        }
+        // wraps around
+        for (int i = 6; i < 13; ++i) {
+            test(lk_ring_push_back(ring, &i));
+        }
+        test(ring->size == 8);
+        test(ring->capacity == 8);
+        test(ring->head + ring->size > ring->capacity);
+        // grows and unwraps
+        value = 13;
+        test(lk_ring_push_back(ring, &value));
+        test(ring->capacity == 16);
+        bool in_order = true;
+        for (size_t i = 0; i < ring->size; ++i) {
+            in_order = in_order && *lk_ring_at(ring, int, i) == (int)i + 5;
+        }
+        test(in_order);
+        value = 4;
+        test(lk_ring_push_front(ring, &value));
+        test(*lk_ring_at(ring, int, 0) == 4);
+        test(lk_ring_pop_back(ring, &value));
+        test(value == 13);
+        test(lk_ring_at(ring, int, ring->size) == NULL);
+        lk_free_ring(ring);
+    }
+
+    {
+        section("ring buffer growth moving the front part");
+        lk_ring* ring = lk_new_ring(sizeof(int), 4);
+        test(ring != NULL);
+        // a short part at the end of the buffer, and a long wrapped one
+        for (int i = 0; i < 4; ++i) {
+            test(lk_ring_push_back(ring, &i));
+        }
+        int value = 0;
+        for (int i = 0; i < 3; ++i) {
+            test(lk_ring_pop_front(ring, &value));
+        }
+        for (int i = 4; i < 8; ++i) {
+            test(lk_ring_push_back(ring, &i));
+        }
+        test(ring->capacity == 8);
+        test(ring->head == 7);
+        bool in_order = true;
+        for (size_t i = 0; i < ring->size; ++i) {
+            in_order = in_order && *lk_ring_at(ring, int, i) == (int)i + 3;
+        }
+        test(in_order);
+        test(ring->size == 5);
+        lk_free_ring(ring);
+    }
+
+    {
+        section("spsc ring");
+        lk_spsc_ring* ring = lk_new_spsc_ring(sizeof(uint64_t), 100);
+        test(ring != NULL);
+        test(ring->mask == 127);
+        uint64_t value = 0;
+        test(lk_spsc_pop(ring, &value) == false);
+        pthread_t producer;
+        pthread_create(&producer, NULL, spsc_producer_main, ring);
+        bool in_order = true;
+        for (uint64_t i = 0; i < SPSC_ITEMS; ++i) {
+            while (!lk_spsc_pop(ring, &value)) {
+                sched_yield();
+            }
+            in_order = in_order && value == i;
+        }
+        pthread_join(producer, NULL);
+        test(in_order);
+        test(lk_spsc_size(ring) == 0);
+        lk_free_spsc_ring(ring);
+    }
+
+    {
+        section("struct of arrays");
+        size_t  sizes[]   = { sizeof(uint32_t), sizeof(double), sizeof(char) };
+        size_t  offsets[] = { offsetof(struct sample, id), offsetof(struct sample, value), offsetof(struct sample, tag) };
+        lk_soa* soa       = lk_new_soa(3, sizes, offsets, sizeof(struct sample));
+        test(soa != NULL);
+        test(soa->record_size == sizeof(struct sample));
+        for (uint32_t i = 0; i < 100; ++i) {
+            struct sample s = { i, i * 0.5, (char)('a' + i % 26) };
+            test(lk_soa_push_back(soa, &s));
+        }
+        test(soa->size == 100);
+        // columns are contiguous
+        double* values = lk_soa_column(soa, double, 1);
+        double  sum    = 0;
+        for (size_t i = 0; i < soa->size; ++i) {
+            sum += values[i];
+        }
+        test(sum == 2475.0);
+        test(*(char*)lk_soa_field_at(soa, 2, 27) == 'b');
+        struct sample s = { 0, 0, 0 };
+        test(lk_soa_get(soa, 42, &s));
+        test(s.id == 42 && s.value == 21.0 && s.tag == 'q');
+        s.value = -1.0;
+        test(lk_soa_set(soa, 42, &s));
+        test(values[42] == -1.0);
+        struct sample rows[10];
+        test(lk_soa_get_records(soa, 90, 10, rows));
+        test(rows[9].id == 99);
+        test(lk_soa_append_records(soa, rows, 10));
+        test(soa->size == 110);
+        test(*lk_soa_column(soa, uint32_t, 0) == 0);
+        test((lk_soa_column(soa, uint32_t, 0))[109] == 99);
+        test(lk_soa_resize(soa, 120));
+        test(*(double*)lk_soa_field_at(soa, 1, 119) == 0.0);
+        test(lk_soa_get_records(soa, 115, 10, rows) == false);
+        test(lk_last_error() == LK_ERR_OUT_OF_BOUNDS);
+        test(lk_soa_field_at(soa, 3, 0) == NULL);
+        lk_free_soa(soa);
+
+        // packed layout
+        soa = lk_new_soa(3, sizes, NULL, 0);
+        test(soa != NULL);
+        test(soa->record_size == 13);
+        test(soa->field_offsets[2] == 12);
+        lk_free_soa(soa);
+        size_t overlapping[] = { 0, 2, 12 };
+        test(lk_new_soa(3, sizes, overlapping, 0) == NULL);
+        test(lk_new_soa(3, sizes, offsets, 8) == NULL);
+    }
+
+    {
+        section("bitset");
+        lk_bitset* bits = lk_new_bitset(130);
+        test(bits != NULL);
+        test(lk_bitset_count(bits) == 0);
+        size_t index = 0;
+        test(!lk_bitset_find_first(bits, 0, &index));
+        test(lk_bitset_set(bits, 3, true));
+        test(lk_bitset_set(bits, 64, true));
+        test(lk_bitset_flip(bits, 129));
+        test(lk_bitset_get(bits, 129));
+        test(!lk_bitset_get(bits, 128));
+        test(lk_bitset_count(bits) == 3);
+        test(lk_bitset_find_first(bits, 0, &index) && index == 3);
+        test(lk_bitset_find_first(bits, 4, &index) && index == 64);
+        test(lk_bitset_find_first(bits, 65, &index) && index == 129);
+        test(lk_bitset_get(bits, 130) == false);
+        test(lk_last_error() == LK_ERR_OUT_OF_BOUNDS);
+        for (int i = 0; i < 100; ++i) {
+            test(lk_bitset_push_back(bits, i % 2 == 0));
+        }
+        test(bits->size == 230);
+        test(lk_bitset_count(bits) == 53);
+        test(lk_bitset_not(bits));
+        test(lk_bitset_count(bits) == 230 - 53);
+        lk_bitset* other = lk_new_bitset(230);
+        test(lk_bitset_or(other, bits));
+        test(lk_bitset_count(other) == 177);
+        test(lk_bitset_xor(other, bits));
+        test(lk_bitset_count(other) == 0);
+        test(lk_bitset_and(bits, other));
+        test(lk_bitset_count(bits) == 0);
+        // shrinking and growing again clears the dropped bits
+        test(lk_bitset_not(bits));
+        test(lk_bitset_resize(bits, 70));
+        test(lk_bitset_resize(bits, 200));
+        test(lk_bitset_count(bits) == 70);
+        test(lk_bitset_and(bits, other) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        lk_free_bitset(other);
+        lk_free_bitset(bits);
+    }
+
+    {
+        section("packed array");
+        test(lk_new_packed_array(1, 17) == NULL);
+        for (size_t b = 1; b <= 16; ++b) {
+            lk_packed_array* arr  = lk_new_packed_array(0, b);
+            unsigned         mask = (1u << b) - 1;
+            test(arr != NULL);
+            for (unsigned i = 0; i < 300; ++i) {
+                lk_packed_push_back(arr, (i * 2654435761u) & mask);
+            }
+            bool intact = true;
+            for (unsigned i = 0; i < 300; ++i) {
+                intact = intact && lk_packed_get(arr, i) == ((i * 2654435761u) & mask);
+            }
+            test(intact);
+            test(lk_packed_set(arr, 21, mask));
+            test(lk_packed_get(arr, 21) == mask);
+            test(lk_packed_get(arr, 20) == ((20 * 2654435761u) & mask));
+            test(lk_packed_get(arr, 22) == ((22 * 2654435761u) & mask));
+            test(lk_packed_set(arr, 0, mask + 1) == false);
+            test(lk_packed_resize(arr, 10));
+            test(lk_packed_resize(arr, 300));
+            test(lk_packed_get(arr, 299) == 0);
+            lk_free_packed_array(arr);
+        }
+    }
+
+    {
+        section("parallel copy, fill, for_each and reduce");
+        // large enough to be split into chunks
+        size_t    count = ((size_t)3 << 20) / sizeof(uint64_t) + 5;
+        lk_array* arr   = lk_new_array(count, sizeof(uint64_t));
+        lk_array* copy  = lk_new_array(0, 1);
+        test(arr != NULL && copy != NULL);
+        test(lk_parallel_for_each(arr, store_index, NULL));
+        test(*lk_at(arr, uint64_t, 0) == 0);
+        test(*lk_at(arr, uint64_t, count - 1) == count - 1);
+        uint64_t sum  = 0;
+        uint64_t zero = 0;
+        test(lk_parallel_reduce(arr, &sum, sizeof(sum), &zero, sum_values, add_sums, NULL));
+        test(sum == (uint64_t)count * (count - 1) / 2);
+        test(lk_parallel_copy(copy, arr));
+        test(copy->memb_size == sizeof(uint64_t));
+        test(lk_equal(copy, arr));
+        uint64_t value = 0xabcdef;
+        test(lk_parallel_fill(copy, &value));
+        test(lk_count(copy, &value) == count);
+        // a snapshot sharing dest's data keeps its elements
+        lk_array* snapshot = lk_new_array(0, 1);
+        test(lk_array_share(snapshot, copy));
+        test(lk_parallel_copy(copy, arr));
+        test(lk_count(snapshot, &value) == count);
+        test(lk_equal(copy, arr));
+        lk_free_array(snapshot);
+        lk_free_array(copy);
+        // an inline dest with a smaller memb_size has to move to the heap
+        copy = lk_new_array_inline(64, 1, 64, NULL);
+        test(copy != NULL);
+        test(lk_parallel_copy(copy, arr));
+        test(copy->memb_size == sizeof(uint64_t) && copy->size == count);
+        test(lk_equal(copy, arr));
+        lk_free_array(copy);
+        // the inline capacity is only 8 elements of the new size
+        copy             = lk_new_array_inline(64, 1, 64, NULL);
+        lk_array* eleven = lk_new_array(11, sizeof(uint64_t));
+        test(copy != NULL && eleven != NULL);
+        test(lk_parallel_copy(copy, eleven));
+        test(copy->size == 11 && copy->capacity >= 11);
+        test(lk_equal(copy, eleven));
+        lk_free_array(eleven);
+        lk_free_array(copy);
+        test(lk_parallel_set_threads(1));
+        test(lk_parallel_threads() == 1);
+        sum = 0;
+        test(lk_parallel_reduce(arr, &sum, sizeof(sum), &zero, sum_values, add_sums, NULL));
+        test(sum == (uint64_t)count * (count - 1) / 2);
+        test(lk_parallel_set_threads(4));
+        test(lk_parallel_threads() == 4);
+        // widths that don't divide a cache line
+        lk_array* odd = lk_new_array(((size_t)2 << 20) / 12, 12);
+        test(odd != NULL);
+        unsigned char pattern[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+        test(lk_parallel_fill(odd, pattern));
+        test(lk_count(odd, pattern) == odd->size);
+        lk_free_array(odd);
+        // calls from inside a callback run serially instead of deadlocking
+        lk_array* inner = lk_new_array(((size_t)2 << 20) / sizeof(uint64_t), sizeof(uint64_t));
+        test(inner != NULL);
+        test(lk_parallel_for_each(arr, fill_nested, inner));
+        value = 7;
+        test(lk_count(inner, &value) == inner->size);
+        lk_free_array(inner);
+        test(lk_parallel_set_threads(0));
+        test(lk_parallel_fill(NULL, &value) == false);
+        test(lk_last_error() == LK_ERR_NULL);
+        test(lk_parallel_reduce(arr, &sum, 0, &zero, sum_values, add_sums, NULL) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        lk_free_array(arr);
+        lk_parallel_shutdown();
+    }
+
+    {
+        section("serialization");
+        char path[] = "/tmp/lk_serial_test_XXXXXX";
+        int  fd     = mkstemp(path);
+        test(fd >= 0);
+        lk_array* arr = lk_new_array(0, sizeof(struct record));
+        test(arr != NULL);
+        for (int32_t i = 0; i < 1000; ++i) {
+            struct record r = { (uint32_t)i, i * 3 };
+            lk_push_back(arr, &r);
+        }
+        test(lk_serial_write_fd(arr, fd, 100) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        test(lk_serial_write_fd(arr, fd, 4096));
+        test(lseek(fd, 0, SEEK_SET) == 0);
+        lk_array* loaded = lk_serial_read_fd(fd);
+        test(loaded != NULL);
+        test(lk_equal(loaded, arr));
+        lk_free_array(loaded);
+        close(fd);
+
+        lk_serial_mapping* mapping = lk_serial_map(path, true);
+        test(mapping != NULL);
+        test(mapping->view.size == 1000);
+        test(mapping->view.memb_size == sizeof(struct record));
+        test((uintptr_t)mapping->view.data % 4096 == 0);
+        test((lk_view_at(&mapping->view, struct record, 999))->key == 999 * 3);
+        lk_serial_unmap(mapping);
+        test(mapping == NULL);
+
+        FILE* file = fopen(path, "w+b");
+        test(file != NULL);
+        test(lk_serial_write_file(arr, file, 0));
+        long bytes = ftell(file);
+        test(bytes == (long)(LK_SERIAL_DEFAULT_ALIGNMENT + 1000 * sizeof(struct record)));
+        rewind(file);
+        // a caller provided buffer, with one byte of slack to misalign it
+        char* buffer = malloc((size_t)bytes + 8);
+        test(buffer != NULL);
+        test(fread(buffer, 1, (size_t)bytes, file) == (size_t)bytes);
+        rewind(file);
+        loaded = lk_serial_read_file(file);
+        test(loaded != NULL);
+        test(lk_equal(loaded, arr));
+        lk_free_array(loaded);
+        fclose(file);
+
+        lk_array_view view;
+        test(lk_serial_view(buffer, (size_t)bytes, true, &view));
+        test(view.data == buffer + LK_SERIAL_DEFAULT_ALIGNMENT);
+        test((lk_view_at(&view, struct record, 10))->id == 10);
+        test(lk_serial_view(buffer, (size_t)bytes - 1, false, &view) == false);
+        memmove(buffer + 1, buffer, (size_t)bytes);
+        test(lk_serial_view(buffer + 1, (size_t)bytes, false, &view) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        memmove(buffer, buffer + 1, (size_t)bytes);
+        // a flipped bit is only noticed when verifying
+        buffer[bytes - 1] ^= 1;
+        test(lk_serial_view(buffer, (size_t)bytes, false, &view));
+        test(lk_serial_view(buffer, (size_t)bytes, true, &view) == false);
+        buffer[0] = 'X';
+        test(lk_serial_view(buffer, (size_t)bytes, false, &view) == false);
+        free(buffer);
+
+        lk_array* empty = lk_new_array(0, 3);
+        fd              = open(path, O_RDWR | O_TRUNC);
+        test(fd >= 0);
+        test(lk_serial_write_fd(empty, fd, 0));
+        test(lseek(fd, 0, SEEK_SET) == 0);
+        loaded = lk_serial_read_fd(fd);
+        test(loaded != NULL && loaded->size == 0 && loaded->memb_size == 3);
+        // nothing left to read
+        test(lk_serial_read_fd(fd) == NULL);
+        lk_free_array(loaded);
+        lk_free_array(empty);
+        close(fd);
+        unlink(path);
+        test(lk_serial_map(path, false) == NULL);
+        lk_free_array(arr);
+    }
+
+    {
+        section("fd reading and writing");
+        int pipe_fds[2];
+        test(pipe(pipe_fds) == 0);
+        lk_fd_reader* reader = lk_new_fd_reader(pipe_fds[0], sizeof(struct record));
+        test(reader != NULL);
+        lk_array* arr = lk_new_array(0, sizeof(struct record));
+        test(arr != NULL);
+        struct record records[4] = { { 1, 10 }, { 2, 20 }, { 3, 30 }, { 4, 40 } };
+        // two and a half records, then the rest
+        size_t half = sizeof(struct record) / 2;
+        test(write(pipe_fds[1], records, 2 * sizeof(struct record) + half) > 0);
+        size_t appended = 0;
+        test(lk_append_from_fd(arr, reader, &appended));
+        test(appended == 2);
+        test(arr->size == 2);
+        test(reader->pending == half);
+        test(write(pipe_fds[1], (char*)records + 2 * sizeof(struct record) + half, 2 * sizeof(struct record) - half) > 0);
+        test(lk_append_from_fd(arr, reader, &appended));
+        test(appended == 2);
+        test(reader->pending == 0);
+        test((lk_at(arr, struct record, 2))->key == 30);
+        test((lk_at(arr, struct record, 3))->id == 4);
+        close(pipe_fds[1]);
+        test(lk_append_from_fd(arr, reader, &appended));
+        test(appended == 0);
+        test(reader->eof);
+        lk_array* wrong = lk_new_array(0, 1);
+        test(lk_append_from_fd(wrong, reader, NULL) == false);
+        test(lk_last_error() == LK_ERR_INVALID_ARG);
+        lk_free_array(wrong);
+        lk_free_fd_reader(reader);
+        close(pipe_fds[0]);
+        lk_free_array(arr);
+
+        // more than fits in the spare capacity, to read into the overflow
+        char path[] = "/tmp/lk_fd_test_XXXXXX";
+        int  fd     = mkstemp(path);
+        test(fd >= 0);
+        lk_array* big = lk_new_array(0, 12);
+        test(big != NULL);
+        for (uint32_t i = 0; i < 100000; ++i) {
+            uint32_t element[3] = { i, i * 7, ~i };
+            lk_push_back(big, element);
+        }
+        test(lk_write_to_fd(big, fd));
+        test(lseek(fd, 0, SEEK_SET) == 0);
+        lk_array* inline_arr = lk_new_array_inline(0, 12, 120, NULL);
+        test(inline_arr != NULL);
+        reader = lk_new_fd_reader(fd, 12);
+        test(reader != NULL);
+        bool read_ok = true;
+        while (read_ok && !reader->eof) {
+            read_ok = lk_append_from_fd(inline_arr, reader, NULL);
+        }
+        test(read_ok);
+        test(lk_equal(inline_arr, big));
+        lk_free_fd_reader(reader);
+        lk_free_array(inline_arr);
+        lk_free_array(big);
+        close(fd);
+        unlink(path);
+
+        // a non-blocking fd without data
+        test(pipe(pipe_fds) == 0);
+        fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+        reader = lk_new_fd_reader(pipe_fds[0], 4);
+        arr    = lk_new_array(0, 4);
+        test(lk_append_from_fd(arr, reader, &appended));
+        test(appended == 0 && !reader->eof);
+        lk_free_fd_reader(reader);
+        lk_free_array(arr);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        test(lk_new_fd_reader(-1, 4) == NULL);
+        test(lk_write_to_fd(NULL, 1) == false);
+    }
+
+    {
+        section("hash set");
+        lk_hash_map* set = lk_new_hash_set(sizeof(int), NULL, NULL);
+        test(set != NULL);
+        bool inserted = false;
+        for (int i = 0; i < 3000; ++i) {
+            int key = i % 1000;
+            lk_hash_insert(set, &key, NULL, &inserted);
+        }
+        test(set->size == 1000);
+        test(set->size <= set->capacity - set->capacity / 8);
+        int key = 999;
+        test(lk_hash_insert(set, &key, NULL, &inserted));
+        test(!inserted);
+        test(*(int*)lk_hash_find(set, &key) == 999);
+        key = 1000;
+        test(!lk_hash_contains(set, &key));
+        test(lk_hash_insert(set, &key, NULL, &inserted));
+        test(inserted);
+        // erase every other key, the rest has to stay reachable
+        for (key = 0; key < 1000; key += 2) {
+            lk_hash_erase(set, &key);
+        }
+        test(set->size == 501);
+        bool intact = true;
+        for (key = 0; key <= 1000; ++key) {
+            intact = intact && lk_hash_contains(set, &key) == (key % 2 == 1 || key == 1000);
+        }
+        test(intact);
+        key = 0;
+        test(lk_hash_erase(set, &key) == false);
+        size_t slot  = 0;
+        size_t count = 0;
+        void*  found = NULL;
+        while (lk_hash_next(set, &slot, &found, NULL)) {
+            ++count;
+        }
+        test(count == 501);
+        size_t capacity = set->capacity;
+        test(lk_hash_rehash(set, 0));
+        test(set->capacity < capacity);
+        key = 777;
+        test(lk_hash_contains(set, &key));
+        test(lk_hash_clear(set));
+        test(set->size == 0 && !lk_hash_contains(set, &key));
+        test(lk_hash_find(NULL, &key) == NULL);
+        test(lk_last_error() == LK_ERR_NULL);
+        lk_free_hash_map(set);
+        test(set == NULL);
+    }
+
+    {
+        section("hash map with colliding keys");
+        // 12 byte keys, 20 byte values, all with the same hash
+        lk_hash_map* map = lk_new_hash_map(12, 20, collide, NULL);
+        test(map != NULL);
+        test(lk_hash_reserve(map, 200));
+        size_t capacity = map->capacity;
+        for (uint32_t i = 0; i < 200; ++i) {
+            uint32_t key[3]   = { i, i * 3, 7 };
+            uint32_t value[5] = { i, 1, 2, 3, ~i };
+            lk_hash_insert(map, key, value, NULL);
+        }
+        test(map->size == 200);
+        test(map->capacity == capacity);
+        uint32_t  key[3] = { 150, 450, 7 };
+        uint32_t* value  = lk_hash_find(map, key);
+        test(value != NULL && value[0] == 150 && value[4] == ~150u);
+        uint32_t new_value[5] = { 0 };
+        test(lk_hash_insert(map, key, new_value, NULL));
+        test(map->size == 200);
+        test(((uint32_t*)lk_hash_find(map, key))[4] == 0);
+        for (uint32_t i = 0; i < 200; i += 3) {
+            uint32_t erased[3] = { i, i * 3, 7 };
+            lk_hash_erase(map, erased);
+        }
+        bool intact = true;
+        for (uint32_t i = 0; i < 200; ++i) {
+            uint32_t  k[3] = { i, i * 3, 7 };
+            uint32_t* v    = lk_hash_find(map, k);
+            intact         = intact && (i % 3 == 0 ? v == NULL : v != NULL && v[0] == (i == 150 ? 0 : i));
+        }
+        test(intact);
+        test(lk_hash_insert(map, key, NULL, NULL) == false);
+        test(lk_new_hash_map(0, 4, NULL, NULL) == NULL);
+        lk_free_hash_map(map);
+    }
+
     report();
 }
@@ -39,7 +39,17 @@
 #ifndef LK_REALLOCARRAY
 // define this to say "my memory manager does not support this".
 #ifdef LK_REALLOCARRAY_NONE
-#error "TODO: Implement custom reallocarray"
+#include <errno.h>
+#include <stdint.h>
+// reallocarray on top of LK_REALLOC, with the same overflow check
+static inline void* lk_reallocarray_fallback(void* ptr, size_t nmemb, size_t size) {
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return LK_REALLOC(ptr, nmemb * size);
+}
+#define LK_REALLOCARRAY lk_reallocarray_fallback
 #else
 #include <stdlib.h>
 // void* reallocarray(void* ptr, size_t nmemb, size_t size)